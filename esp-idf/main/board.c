@@ -0,0 +1,43 @@
+#include "board.h"
+
+const board_actuator_t board_actuators[ACT_COUNT] = {
+#define BOARD_ACT_ENTRY(name, cmd, pin, drive, active, ma, prio) \
+    [ACT_##name] = { cmd, pin, drive, ma, prio },
+    BOARD_ACTUATORS(BOARD_ACT_ENTRY)
+#undef BOARD_ACT_ENTRY
+};
+
+void board_init(void) {
+    for (int i = 0; i < ACT_COUNT; i++) {
+        board_actuator_set((board_actuator_id_t)i, false);
+    }
+
+    // 一次 gpio_config 配置全部执行器输出
+    gpio_config_t out_conf = {
+        .pin_bit_mask = BOARD_OUTPUT_MASK,
+        .mode = GPIO_MODE_OUTPUT,              // 输出模式
+        .pull_up_en = GPIO_PULLUP_DISABLE,     // 禁用上拉
+        .pull_down_en = GPIO_PULLDOWN_DISABLE, // 禁用下拉
+        .intr_type = GPIO_INTR_DISABLE         // 禁用中断
+    };
+    gpio_config(&out_conf);
+
+    // 传感器输入 (上拉按表逐个设置)
+    gpio_config_t in_conf = {
+        .pin_bit_mask = BOARD_INPUT_MASK,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE
+    };
+    gpio_config(&in_conf);
+#define BOARD_SENSOR_PULL(name, pin, pull) \
+    if ((pull) == GPIO_PULLUP_ENABLE) gpio_pullup_en(pin);
+    BOARD_SENSORS(BOARD_SENSOR_PULL)
+#undef BOARD_SENSOR_PULL
+
+    // gpio_config 之后再写一次，确保输出电平为关闭
+    for (int i = 0; i < ACT_COUNT; i++) {
+        board_actuator_set((board_actuator_id_t)i, false);
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "driver/gpio.h"
+#include "hal/gpio_ll.h"
+#include "soc/gpio_struct.h"
+
+// 板级描述：每个执行器和传感器引脚只在下面的表中写一次。
+// GPIO初始化掩码、命令表、执行器编号和寄存器写操作都在编译期由表展开，
+// 运行时不再按引脚查找，也不需要对引脚做范围检查。
+
+#define GPIO_PIN_SOIL_1        GPIO_NUM_2     // 土壤湿度探头1 (ADC1)
+#define GPIO_PIN_SOIL_2        GPIO_NUM_3     // 土壤湿度探头2 (ADC1)
+#define GPIO_PIN_PUMP          GPIO_NUM_4     // 蠕动泵控制引脚 (通过IRFZ44N)
+#define GPIO_PIN_FAN           GPIO_NUM_5     // 散热风扇控制引脚 (通过2N7000)
+#define GPIO_PIN_LED           GPIO_NUM_6     // LED灯组控制引脚 (通过IRFZ44N)
+#define GPIO_PIN_TEC           GPIO_NUM_7     // TEC半导体制冷片控制引脚 (通过IRFZ44N)
+#define GPIO_PIN_SENSOR_POWER  GPIO_NUM_8     // 土壤湿度传感器电源控制 (通过SS8050)
+#define GPIO_PIN_DHT           GPIO_NUM_10    // DHT温湿度传感器数据线
+#define GPIO_PIN_ONEWIRE       GPIO_NUM_11    // DS18B20 1-Wire总线 (外接4.7k上拉)
+
+typedef enum {
+    DRIVE_MOSFET,   // MOSFET低边开关，开启由电源预算调度
+    DRIVE_BJT,      // 三极管，直接开关，开启后等待负载稳定
+    DRIVE_PWM,      // MOSFET由LEDC PWM驱动，输出归温控/补光模块，开启同样由电源预算调度
+} board_drive_t;
+
+// 执行器表 (优先级: 数值越小越先开启，泵 > 风扇 > TEC > LED)
+//  名称     命令       引脚                   驱动          有效电平 电流mA 优先级
+#define BOARD_ACTUATORS(X) \
+    X(PUMP,   "pump",   GPIO_PIN_PUMP,          DRIVE_MOSFET, 1,      400,   0) \
+    X(FAN,    "fan",    GPIO_PIN_FAN,           DRIVE_PWM,    1,      150,   1) \
+    X(LED,    "led",    GPIO_PIN_LED,           DRIVE_PWM,    1,      800,   3) \
+    X(TEC,    "tec",    GPIO_PIN_TEC,           DRIVE_PWM,    1,      2000,  2) \
+    X(SENSOR, "sensor", GPIO_PIN_SENSOR_POWER,  DRIVE_BJT,    1,      0,     0)
+
+// 传感器输入表
+//  名称     引脚              上拉
+#define BOARD_SENSORS(X) \
+    X(DHT,     GPIO_PIN_DHT,     GPIO_PULLUP_ENABLE) \
+    X(ONEWIRE, GPIO_PIN_ONEWIRE, GPIO_PULLUP_ENABLE) \
+    X(SOIL_1,  GPIO_PIN_SOIL_1,  GPIO_PULLUP_DISABLE) \
+    X(SOIL_2,  GPIO_PIN_SOIL_2,  GPIO_PULLUP_DISABLE)
+
+/* ---------- 以下均由上面的表展开 ---------- */
+
+typedef enum {
+#define BOARD_ACT_ID(name, cmd, pin, drive, active, ma, prio) ACT_##name,
+    BOARD_ACTUATORS(BOARD_ACT_ID)
+#undef BOARD_ACT_ID
+    ACT_COUNT
+} board_actuator_id_t;
+
+#define BOARD_ACT_BIT(name, cmd, pin, drive, active, ma, prio) | (1ULL << (pin))
+#define BOARD_SENSOR_BIT(name, pin, pull) | (1ULL << (pin))
+
+#define BOARD_OUTPUT_MASK  (0ULL BOARD_ACTUATORS(BOARD_ACT_BIT))
+#define BOARD_INPUT_MASK   (0ULL BOARD_SENSORS(BOARD_SENSOR_BIT))
+
+_Static_assert(__builtin_popcountll(BOARD_OUTPUT_MASK) == ACT_COUNT, "执行器引脚重复");
+_Static_assert((BOARD_OUTPUT_MASK & BOARD_INPUT_MASK) == 0, "引脚同时用作输入和输出");
+
+typedef struct {
+    const char *command;     // 串口命令中的设备名
+    gpio_num_t pin;
+    board_drive_t drive;
+    uint16_t current_ma;
+    uint8_t priority;
+} board_actuator_t;
+
+// 命令表，下标即执行器编号
+extern const board_actuator_t board_actuators[ACT_COUNT];
+
+// 开关执行器：编号为常量时编译为一条GPIO置位/清零寄存器写
+static inline void board_actuator_set(board_actuator_id_t id, bool on) {
+    switch (id) {
+#define BOARD_ACT_SET(name, cmd, pin, drive, active, ma, prio) \
+        case ACT_##name: gpio_ll_set_level(&GPIO, (pin), on ? (active) : !(active)); break;
+        BOARD_ACTUATORS(BOARD_ACT_SET)
+#undef BOARD_ACT_SET
+        default: break;
+    }
+}
+
+// 按表配置全部引脚：执行器先置为关闭电平再设为输出，避免上电毛刺
+void board_init(void);
+
+#endif
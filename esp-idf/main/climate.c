@@ -0,0 +1,278 @@
+#include "climate.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "dht.h"
+#include "power_budget.h"
+#include "pwm.h"
+
+#define CLIMATE_PERIOD_MS      2000            // DHT22 最短采样间隔
+#define CLIMATE_DHT_TYPE       DHT_TYPE_DHT22
+#define CLIMATE_MAX_ERRORS     3               // 连续读取失败后进入保护
+#define CLIMATE_SUPPLY_V       5.0f
+
+#define CLIMATE_DEFAULT_TEMP   24.0f
+#define CLIMATE_DEFAULT_HUM    60.0f
+
+// TEC 温度环 (误差单位 °C，输出为占空比)
+#define TEC_KP                 0.25f           // 每°C
+#define TEC_KI                 0.004f          // 每°C·s，积分时间约60s
+#define TEC_KD                 10.0f           // 每°C/s，作用于测量值
+#define TEC_D_TAU_S            10.0f           // 微分一阶低通时间常数，约5个采样
+#define TEC_KT                 0.05f           // 反算抗饱和增益
+#define TEC_MIN_DUTY           0.05f           // 低于此直接关断
+
+// 风扇：TEC 开启时热端必须散热，占空比按 TEC 前馈；湿度偏高时加速
+#define FAN_TEC_BASE           0.35f
+#define FAN_TEC_GAIN           0.65f
+#define FAN_HUM_KP             0.05f           // 每%RH
+#define FAN_MIN_DUTY           0.15f           // 风扇低于此转速不可靠
+#define FAN_FAILSAFE_DUTY      0.30f           // 传感器失效时保持通风
+
+typedef struct {
+    float kp, ki, kd, kt;
+    float d_tau;
+    float integral;
+    float prev_meas;
+    float derivative;     // 滤波后的测量值变化率
+    bool primed;
+} climate_pid_t;
+
+static climate_pid_t s_tec_pid = { TEC_KP, TEC_KI, TEC_KD, TEC_KT, TEC_D_TAU_S, 0, 0, 0, false };
+
+static pwm_out_t s_tec_pwm;
+static pwm_out_t s_fan_pwm;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static climate_status_t s_status;
+static float s_manual_tec = 0.0f;
+static float s_manual_fan = 0.0f;
+static double s_energy_j = 0.0;       // 累加用双精度，避免长时间运行丢失精度
+static int64_t s_energy_since_us = 0;
+static uint8_t s_error_run = 0;
+static bool s_pid_reset = false;
+
+static float clampf(float v, float lo, float hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+// 误差为正表示需要更多输出。返回未限幅的输出，积分在 pid_commit 中更新。
+// 对测量值微分，设定值跳变不冲击。DHT22 分辨率0.1°C，单步跳变按2s周期
+// 就是0.05°C/s，不滤波时 Kd 会让输出跳0.5；一阶低通后约为其1/6。
+static float pid_compute(climate_pid_t *pid, float error, float meas, float dt) {
+    if (!pid->primed) {
+        pid->derivative = 0.0f;
+    } else if (dt > 0.0f) {
+        float raw = (meas - pid->prev_meas) / dt;
+        pid->derivative += (raw - pid->derivative) * dt / (pid->d_tau + dt);
+    }
+    pid->prev_meas = meas;
+    pid->primed = true;
+    return pid->kp * error + pid->integral + pid->kd * pid->derivative;
+}
+
+// 反算抗饱和：按实际输出 (受限幅和电源预算影响) 与计算值之差回拉积分
+static void pid_commit(climate_pid_t *pid, float error, float raw, float applied, float dt) {
+    pid->integral += (pid->ki * error + pid->kt * (applied - raw)) * dt;
+    pid->integral = clampf(pid->integral, -1.0f, 1.0f);
+}
+
+static float actuator_watts(board_actuator_id_t id) {
+    return board_actuators[id].current_ma * CLIMATE_SUPPLY_V / 1000.0f;
+}
+
+// 经电源预算开关输出，返回实际生效的占空比
+static float apply_output(board_actuator_id_t id, pwm_out_t *pwm, float duty, float min_duty) {
+    if (duty < min_duty) {
+        power_budget_release(id);   // 同时取消排队中的请求
+        duty = 0.0f;
+    } else if (!power_budget_request(id)) {
+        duty = 0.0f;   // 排队等待电源预算
+    }
+    pwm_set(pwm, duty);
+    return duty;
+}
+
+static void climate_step(float dt) {
+    float t, h;
+    esp_err_t err = dht_read(GPIO_PIN_DHT, CLIMATE_DHT_TYPE, &t, &h);
+
+    portENTER_CRITICAL(&s_lock);
+    climate_mode_t mode = s_status.mode;
+    float set_t = s_status.set_temperature;
+    float set_h = s_status.set_humidity;
+    float manual_tec = s_manual_tec;
+    float manual_fan = s_manual_fan;
+    bool pid_reset = s_pid_reset;
+    s_pid_reset = false;
+    if (err == ESP_OK) {
+        s_status.temperature = t;
+        s_status.humidity = h;
+        s_error_run = 0;
+    } else {
+        s_status.read_errors++;
+        if (s_error_run < 255) s_error_run++;
+    }
+    bool sensor_ok = s_error_run < CLIMATE_MAX_ERRORS;
+    s_status.sensor_ok = sensor_ok;
+    t = s_status.temperature;
+    h = s_status.humidity;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (pid_reset) {
+        s_tec_pid.integral = 0.0f;
+        s_tec_pid.primed = false;
+    }
+
+    float tec = 0.0f, fan = 0.0f;
+    float error = 0.0f, raw = 0.0f;
+    bool closed_loop = mode == CLIMATE_AUTO && sensor_ok;
+    if (mode == CLIMATE_MANUAL) {
+        tec = manual_tec;
+        fan = manual_fan;
+    } else if (closed_loop) {
+        error = t - set_t;                        // 偏热为正，需要制冷
+        raw = pid_compute(&s_tec_pid, error, t, dt);
+        tec = clampf(raw, 0.0f, 1.0f);
+        fan = FAN_HUM_KP * (h - set_h);
+    } else if (mode == CLIMATE_AUTO) {
+        fan = FAN_FAILSAFE_DUTY;                  // 传感器失效：TEC关断，保持通风
+        s_tec_pid.integral = 0.0f;
+    }
+
+    // 前馈：热端散热量随 TEC 占空比增加，风扇转速直接跟随
+    if (tec >= TEC_MIN_DUTY) fan = fmaxf(fan, FAN_TEC_BASE + FAN_TEC_GAIN * tec);
+    fan = apply_output(ACT_FAN, &s_fan_pwm, clampf(fan, 0.0f, 1.0f), FAN_MIN_DUTY);
+
+    // 风扇未运行 (如仍在等待电源预算) 时 TEC 不得开启
+    if (fan <= 0.0f) tec = 0.0f;
+    tec = apply_output(ACT_TEC, &s_tec_pwm, tec, TEC_MIN_DUTY);
+    if (closed_loop) pid_commit(&s_tec_pid, error, raw, tec, dt);
+
+    portENTER_CRITICAL(&s_lock);
+    s_status.tec_duty = tec;
+    s_status.fan_duty = fan;
+    s_energy_j += (tec * actuator_watts(ACT_TEC) + fan * actuator_watts(ACT_FAN)) * dt;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+static void climate_task(void *arg) {
+    int64_t last_us = esp_timer_get_time();
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(CLIMATE_PERIOD_MS));
+        int64_t now_us = esp_timer_get_time();
+        climate_step((now_us - last_us) / 1e6f);
+        last_us = now_us;
+    }
+}
+
+void climate_init(void) {
+    pwm_init(&s_tec_pwm, GPIO_PIN_TEC, PWM_CH_TEC, PWM_TIMER_POWER, PWM_FREQ_POWER);
+    pwm_init(&s_fan_pwm, GPIO_PIN_FAN, PWM_CH_FAN, PWM_TIMER_FAN, PWM_FREQ_FAN);
+    esp_err_t err = dht_init(GPIO_PIN_DHT);
+    if (err != ESP_OK) {
+        printf("[温控] DHT初始化失败: %s\n", esp_err_to_name(err));
+    }
+
+    memset(&s_status, 0, sizeof(s_status));
+    s_status.mode = CLIMATE_AUTO;
+    s_status.set_temperature = CLIMATE_DEFAULT_TEMP;
+    s_status.set_humidity = CLIMATE_DEFAULT_HUM;
+    s_status.full_power_w = actuator_watts(ACT_TEC) + actuator_watts(ACT_FAN);
+    s_energy_since_us = esp_timer_get_time();
+
+    xTaskCreate(climate_task, "climate", 3072, NULL, 4, NULL);
+}
+
+void climate_set_mode(climate_mode_t mode) {
+    portENTER_CRITICAL(&s_lock);
+    s_status.mode = mode;
+    s_manual_tec = 0.0f;
+    s_manual_fan = 0.0f;
+    s_pid_reset = true;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void climate_set_target(float temperature, float humidity) {
+    portENTER_CRITICAL(&s_lock);
+    s_status.set_temperature = temperature;
+    s_status.set_humidity = humidity;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void climate_manual(board_actuator_id_t id, uint8_t state) {
+    portENTER_CRITICAL(&s_lock);
+    if (s_status.mode != CLIMATE_MANUAL) {
+        s_status.mode = CLIMATE_MANUAL;
+        s_manual_tec = s_manual_fan = 0.0f;
+    }
+    if (id == ACT_TEC) s_manual_tec = state ? 1.0f : 0.0f;
+    if (id == ACT_FAN) s_manual_fan = state ? 1.0f : 0.0f;
+    portEXIT_CRITICAL(&s_lock);
+    printf("[温控] 手动模式：%s -> %s (下个周期生效，\"climate auto\" 恢复闭环)\n",
+           board_actuators[id].command, state ? "开启" : "关闭");
+}
+
+void climate_get_status(climate_status_t *status) {
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&s_lock);
+    *status = s_status;
+    status->energy_wh = (float)(s_energy_j / 3600.0);
+    float seconds = (now_us - s_energy_since_us) / 1e6f;
+    status->average_w = seconds > 0.0f ? (float)(s_energy_j / seconds) : 0.0f;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void climate_reset_energy(void) {
+    portENTER_CRITICAL(&s_lock);
+    s_energy_j = 0.0;
+    s_energy_since_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&s_lock);
+}
+
+static void print_status(void) {
+    static const char *mode_names[] = { "关闭", "自动", "手动" };
+    climate_status_t st;
+    climate_get_status(&st);
+    printf("[温控] 模式: %s  传感器: %s (累计错误 %lu)\n", mode_names[st.mode],
+           st.sensor_ok ? "正常" : "失效", (unsigned long)st.read_errors);
+    printf("[温控] 温度 %.1f°C (目标 %.1f)  湿度 %.1f%% (目标 %.1f)\n",
+           st.temperature, st.set_temperature, st.humidity, st.set_humidity);
+    printf("[温控] TEC %.0f%%  风扇 %.0f%%\n", st.tec_duty * 100, st.fan_duty * 100);
+    printf("[温控] 能耗 %.2f Wh  平均 %.2f W (满功率 %.1f W 的 %.0f%%)\n",
+           st.energy_wh, st.average_w, st.full_power_w,
+           st.full_power_w > 0 ? st.average_w / st.full_power_w * 100 : 0);
+}
+
+void climate_command(const char *args) {
+    char sub[16] = "";
+    float t, h;
+    sscanf(args, "%15s", sub);
+
+    if (sub[0] == '\0' || strcmp(sub, "status") == 0) {
+        print_status();
+    } else if (strcmp(sub, "auto") == 0) {
+        climate_set_mode(CLIMATE_AUTO);
+        printf("[温控] 闭环控制已开启\n");
+    } else if (strcmp(sub, "off") == 0) {
+        climate_set_mode(CLIMATE_OFF);
+        printf("[温控] 已关闭 TEC 与风扇\n");
+    } else if (strcmp(sub, "set") == 0 && sscanf(args, "%*s %f %f", &t, &h) == 2) {
+        if (t < 5.0f || t > 40.0f || h < 0.0f || h > 100.0f) {
+            printf("[错误] 目标超出范围 (温度5~40°C，湿度0~100%%)\n");
+            return;
+        }
+        climate_set_target(t, h);
+        printf("[温控] 目标 %.1f°C / %.1f%%RH\n", t, h);
+    } else if (strcmp(sub, "reset") == 0) {
+        climate_reset_energy();
+        printf("[温控] 能耗计数已清零\n");
+    } else {
+        printf("用法: climate [status|auto|off|set <温度> <湿度>|reset]\n");
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef CLIMATE_H
+#define CLIMATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "board.h"
+
+// 温湿度闭环控制：DHT读数 -> PID -> TEC/风扇 LEDC PWM占空比。
+// TEC 用带抗积分饱和 (反算法) 的 PID 控制温度；风扇按 TEC 占空比前馈
+// (热端散热需求)，并按湿度偏差加速。两路输出仍受电源预算约束。
+
+typedef enum {
+    CLIMATE_OFF,      // 两路输出关闭
+    CLIMATE_AUTO,     // 闭环控制
+    CLIMATE_MANUAL,   // 串口 "tec/fan 0|1" 直接给定
+} climate_mode_t;
+
+typedef struct {
+    climate_mode_t mode;
+    bool sensor_ok;
+    float temperature;        // °C
+    float humidity;           // %RH
+    float set_temperature;
+    float set_humidity;
+    float tec_duty;           // 实际输出 0~1
+    float fan_duty;
+    float energy_wh;          // 自启动或上次清零以来
+    float average_w;
+    float full_power_w;       // 两路满功率之和，用于比较
+    uint32_t read_errors;
+} climate_status_t;
+
+// 初始化PWM与传感器并启动控制任务
+void climate_init(void);
+
+void climate_set_mode(climate_mode_t mode);
+void climate_set_target(float temperature, float humidity);
+
+// 手动给定 TEC 或风扇 (切换到手动模式)
+void climate_manual(board_actuator_id_t id, uint8_t state);
+
+void climate_get_status(climate_status_t *status);
+void climate_reset_energy(void);
+
+// 串口命令 "climate ..." 的参数部分
+void climate_command(const char *args);
+
+#endif
@@ -0,0 +1,104 @@
+#include "dht.h"
+
+#include <stdint.h>
+#include "driver/rmt_rx.h"
+#include "esp_rom_sys.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include "dht_decode.h"
+
+#define DHT_RMT_RESOLUTION_HZ  1000000   // 1us 一个tick
+#define DHT_RMT_SYMBOLS        64        // 一帧约43个symbol
+#define DHT_RMT_MEM_SYMBOLS    48        // C6 每通道的RMT内存
+#define DHT_GLITCH_NS          1000      // 短于此的毛刺由RMT滤掉
+// 无边沿持续这么久即认为一帧结束。接收在起始脉冲之前开始，
+// 所以必须长于主机自己的起始低电平
+#define DHT22_IDLE_US          3000
+#define DHT11_IDLE_US          32000
+#define DHT_CAPTURE_TIMEOUT_MS 100
+
+static rmt_channel_handle_t s_rx;
+static QueueHandle_t s_done;
+static rmt_symbol_word_t s_symbols[DHT_RMT_SYMBOLS];
+
+// RMT中断里调用：把接收结果交给等待中的 dht_read
+static bool on_recv_done(rmt_channel_handle_t channel, const rmt_rx_done_event_data_t *event, void *ctx) {
+    BaseType_t woken = pdFALSE;
+    xQueueSendFromISR(s_done, event, &woken);
+    return woken == pdTRUE;
+}
+
+esp_err_t dht_init(gpio_num_t pin) {
+    const rmt_rx_channel_config_t conf = {
+        .gpio_num = pin,
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz = DHT_RMT_RESOLUTION_HZ,
+        .mem_block_symbols = DHT_RMT_MEM_SYMBOLS,
+    };
+    const rmt_rx_event_callbacks_t cbs = { .on_recv_done = on_recv_done };
+
+    s_done = xQueueCreate(1, sizeof(rmt_rx_done_event_data_t));
+    if (s_done == NULL) return ESP_ERR_NO_MEM;
+    esp_err_t err = rmt_new_rx_channel(&conf, &s_rx);
+    if (err == ESP_OK) err = rmt_rx_register_event_callbacks(s_rx, &cbs, NULL);
+    if (err == ESP_OK) err = rmt_enable(s_rx);
+    if (err != ESP_OK) {
+        s_rx = NULL;
+        return err;
+    }
+
+    // RX只占用输入矩阵；起始脉冲由GPIO输出寄存器驱动，开漏加上拉
+    gpio_set_direction(pin, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_pullup_en(pin);
+    gpio_set_level(pin, 1);
+    return ESP_OK;
+}
+
+esp_err_t dht_read(gpio_num_t pin, dht_type_t type, float *temperature, float *humidity) {
+    if (s_rx == NULL) return ESP_ERR_INVALID_STATE;
+
+    // 先开始接收，RMT会记下起始脉冲、应答与40位数据
+    const rmt_receive_config_t rx = {
+        .signal_range_min_ns = DHT_GLITCH_NS,
+        .signal_range_max_ns = (type == DHT_TYPE_DHT11 ? DHT11_IDLE_US : DHT22_IDLE_US) * 1000,
+    };
+    xQueueReset(s_done);
+    esp_err_t err = rmt_receive(s_rx, s_symbols, sizeof(s_symbols), &rx);
+    if (err != ESP_OK) return err;
+
+    // 起始信号：主机拉低 (DHT11 至少18ms，DHT22 至少1ms)，再释放。
+    // 之后的时序全由RMT记录，不必关中断
+    gpio_set_level(pin, 0);
+    if (type == DHT_TYPE_DHT11) {
+        vTaskDelay(pdMS_TO_TICKS(20) + 1);   // 多一个tick，保证不短于20ms
+    } else {
+        esp_rom_delay_us(1100);
+    }
+    gpio_set_level(pin, 1);
+
+    rmt_rx_done_event_data_t done;
+    if (xQueueReceive(s_done, &done, pdMS_TO_TICKS(DHT_CAPTURE_TIMEOUT_MS)) != pdTRUE) {
+        // 放弃这次接收，下次重新开始
+        rmt_disable(s_rx);
+        rmt_enable(s_rx);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    uint8_t data[5];
+    err = dht_decode_rmt(&done.received_symbols[0].val, done.num_symbols,
+                         DHT_RMT_RESOLUTION_HZ / 1000000, data);
+    if (err != ESP_OK) return err;
+
+    if (type == DHT_TYPE_DHT11) {
+        *humidity = data[0] + data[1] * 0.1f;
+        *temperature = data[2] + (data[3] & 0x7F) * 0.1f;
+        if (data[3] & 0x80) *temperature = -*temperature;
+    } else {
+        *humidity = ((data[0] << 8) | data[1]) * 0.1f;
+        *temperature = (((data[2] & 0x7F) << 8) | data[3]) * 0.1f;
+        if (data[2] & 0x80) *temperature = -*temperature;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,25 @@
+#ifndef DHT_H
+#define DHT_H
+
+#include "driver/gpio.h"
+#include "esp_err.h"
+
+// DHT11 / DHT22(AM2302) 单总线温湿度传感器读取。
+// 数据线需上拉 (板级表中已启用内部上拉，建议外加4.7k)。
+
+typedef enum {
+    DHT_TYPE_DHT11,
+    DHT_TYPE_DHT22,
+} dht_type_t;
+
+// 在引脚上装一个RMT接收通道，并把引脚设为开漏输入输出、释放总线
+esp_err_t dht_init(gpio_num_t pin);
+
+// 读取一帧：GPIO发起始脉冲，RMT记录应答的电平时长，不关中断；
+// 由与Arduino版共用的 DHTDecoder 解码。调用任务阻塞约 DHT22 10ms /
+// DHT11 60ms。两次读取至少间隔：DHT11 1s，DHT22 2s。
+// 返回 ESP_ERR_TIMEOUT (无响应/时序错误)、ESP_ERR_INVALID_CRC (校验失败)
+// 或 ESP_ERR_INVALID_STATE (RMT通道未装好)
+esp_err_t dht_read(gpio_num_t pin, dht_type_t type, float *temperature, float *humidity);
+
+#endif
@@ -0,0 +1,22 @@
+#include "dht_decode.h"
+
+#include <string.h>
+#include "DHT_Decoder.h"
+
+#define DHT_MAX_PULSES  86   // 起始脉冲与应答4个 + 40位各一低一高 + 余量
+
+extern "C" esp_err_t dht_decode_rmt(const uint32_t *symbols, size_t count, uint32_t ticks_per_us,
+                                    uint8_t data[5]) {
+    uint32_t pulses[DHT_MAX_PULSES];
+    size_t n = DHTDecoder::fromRmt(symbols, count, pulses, DHT_MAX_PULSES);
+    size_t p = DHTDecoder::skipPreamble(pulses, n, ticks_per_us);
+    DHTFrame frame;
+    DHTDecoder::decode(pulses + p, n - p, ticks_per_us, frame);
+    memcpy(data, frame.data, 5);
+
+    switch (frame.status) {
+    case DHT_DECODE_OK:       return ESP_OK;
+    case DHT_DECODE_CHECKSUM: return ESP_ERR_INVALID_CRC;
+    default:                  return ESP_ERR_TIMEOUT;
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef DHT_DECODE_H
+#define DHT_DECODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// DHTDecoder (old_version/lib/DHT sensor library/DHT_Decoder.cpp) 的C接口，
+// 两个版本共用同一个解码器。symbols 为RMT接收到的原始32位symbol，
+// 包含主机起始脉冲与应答；ticks_per_us 为RMT通道分辨率。
+// 返回 ESP_OK、ESP_ERR_INVALID_CRC (40位齐全但校验失败) 或 ESP_ERR_TIMEOUT
+esp_err_t dht_decode_rmt(const uint32_t *symbols, size_t count, uint32_t ticks_per_us,
+                         uint8_t data[5]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
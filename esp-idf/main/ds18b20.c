@@ -0,0 +1,209 @@
+#include "ds18b20.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "board.h"
+#include "onewire.h"
+
+#define DS18B20_UART           UART_NUM_1
+#define DS18B20_PERIOD_MS      5000
+#define DS18B20_POLL_MS        10              // 转换完成轮询间隔
+#define DS18B20_DEFAULT_BITS   12
+
+#define DS18B20_FAMILY         0x28
+#define DS18B20_CMD_CONVERT    0x44
+#define DS18B20_CMD_WRITE_SP   0x4E
+#define DS18B20_CMD_READ_SP    0xBE
+#define DS18B20_SCRATCHPAD     9               // 温度2 + TH/TL 2 + 配置1 + 保留3 + CRC1
+
+static onewire_bus_t s_bus;
+static bool s_bus_ok = false;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static ds18b20_probe_t s_probes[DS18B20_MAX_PROBES];
+static int s_count = 0;
+static uint8_t s_bits = DS18B20_DEFAULT_BITS;
+static uint32_t s_last_convert_ms = 0;         // 上次实际转换耗时
+// 串口命令只置标志，由采样任务在下个周期执行，总线只被一个任务访问
+static uint8_t s_pending_bits = 0;
+static bool s_pending_scan = false;
+
+// 各分辨率的最长转换时间 (数据手册 tCONV)
+static uint32_t conversion_ms(uint8_t bits) {
+    return 750 >> (12 - bits);
+}
+
+static esp_err_t scan_bus(void) {
+    ds18b20_probe_t found[DS18B20_MAX_PROBES];
+    int n = 0;
+    onewire_search_t search;
+    uint8_t rom[8];
+    onewire_search_start(&search);
+    esp_err_t err;
+    while (n < DS18B20_MAX_PROBES && (err = onewire_search_next(&s_bus, &search, rom)) == ESP_OK) {
+        if (rom[0] != DS18B20_FAMILY) continue;
+        memcpy(found[n].rom, rom, 8);
+        found[n].temperature = NAN;
+        found[n].errors = 0;
+        n++;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    memcpy(s_probes, found, sizeof(found[0]) * n);
+    s_count = n;
+    portEXIT_CRITICAL(&s_lock);
+    return n > 0 || err == ESP_ERR_NOT_FOUND ? ESP_OK : err;
+}
+
+// 广播写暂存器：所有探头同时改分辨率 (不写EEPROM，上电后由任务重新设置)
+static esp_err_t set_resolution(uint8_t bits) {
+    esp_err_t err = onewire_reset(&s_bus);
+    if (err != ESP_OK) return err;
+    const uint8_t cmd[] = {
+        ONEWIRE_CMD_SKIP_ROM, DS18B20_CMD_WRITE_SP,
+        0x7F, 0x80,                         // TH/TL 报警上下限，不使用
+        (uint8_t)(((bits - 9) << 5) | 0x1F),
+    };
+    return onewire_transfer(&s_bus, cmd, sizeof(cmd), NULL, 0);
+}
+
+// 一条广播命令让所有探头同时转换，轮询到全部完成 (外部供电时忙的器件读时隙回0)
+static esp_err_t convert_all(uint8_t bits) {
+    esp_err_t err = onewire_reset(&s_bus);
+    if (err != ESP_OK) return err;
+    const uint8_t cmd[] = { ONEWIRE_CMD_SKIP_ROM, DS18B20_CMD_CONVERT };
+    err = onewire_transfer(&s_bus, cmd, sizeof(cmd), NULL, 0);
+    if (err != ESP_OK) return err;
+
+    int64_t start = esp_timer_get_time();
+    uint32_t limit_ms = conversion_ms(bits) + DS18B20_POLL_MS;
+    bool done = false;
+    while (!done && (esp_timer_get_time() - start) / 1000 < limit_ms) {
+        vTaskDelay(pdMS_TO_TICKS(DS18B20_POLL_MS));
+        err = onewire_read_bit(&s_bus, &done);
+        if (err != ESP_OK) return err;
+    }
+    s_last_convert_ms = (esp_timer_get_time() - start) / 1000;
+    return done ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+// MATCH ROM + READ SCRATCHPAD 与9个字节的读时隙在一次UART收发中完成
+static esp_err_t read_probe(const uint8_t rom[8], float *temperature) {
+    esp_err_t err = onewire_reset(&s_bus);
+    if (err != ESP_OK) return err;
+    uint8_t cmd[10] = { ONEWIRE_CMD_MATCH_ROM };
+    memcpy(cmd + 1, rom, 8);
+    cmd[9] = DS18B20_CMD_READ_SP;
+    uint8_t sp[DS18B20_SCRATCHPAD];
+    err = onewire_transfer(&s_bus, cmd, sizeof(cmd), sp, sizeof(sp));
+    if (err != ESP_OK) return err;
+    if (onewire_crc8(sp, sizeof(sp)) != 0) return ESP_ERR_INVALID_CRC;
+
+    // 低分辨率时温度的最低几位未定义，按配置寄存器清零
+    uint8_t bits = 9 + ((sp[4] >> 5) & 3);
+    int16_t raw = (int16_t)((sp[1] << 8) | sp[0]);
+    raw &= ~((1 << (12 - bits)) - 1);
+    *temperature = raw / 16.0f;
+    return ESP_OK;
+}
+
+static void ds18b20_step(void) {
+    portENTER_CRITICAL(&s_lock);
+    uint8_t pending_bits = s_pending_bits;
+    bool pending_scan = s_pending_scan;
+    s_pending_bits = 0;
+    s_pending_scan = false;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (pending_scan && scan_bus() == ESP_OK) {
+        printf("[探头] 搜索完成，共 %d 个 DS18B20\n", s_count);
+        pending_bits = s_bits;          // 新接入的探头也要设置分辨率
+    }
+    if (pending_bits && set_resolution(pending_bits) == ESP_OK) s_bits = pending_bits;
+    if (s_count == 0) return;
+
+    bool converted = convert_all(s_bits) == ESP_OK;
+    for (int i = 0; i < s_count; i++) {
+        float t = NAN;
+        bool ok = converted && read_probe(s_probes[i].rom, &t) == ESP_OK;
+        portENTER_CRITICAL(&s_lock);
+        s_probes[i].temperature = t;
+        if (!ok) s_probes[i].errors++;
+        portEXIT_CRITICAL(&s_lock);
+    }
+}
+
+static void ds18b20_task(void *arg) {
+    while (1) {
+        ds18b20_step();
+        vTaskDelay(pdMS_TO_TICKS(DS18B20_PERIOD_MS));
+    }
+}
+
+void ds18b20_init(void) {
+    esp_err_t err = onewire_init(&s_bus, DS18B20_UART, GPIO_PIN_ONEWIRE);
+    if (err != ESP_OK) {
+        printf("[探头] 1-Wire总线初始化失败: %s\n", esp_err_to_name(err));
+        return;
+    }
+    s_bus_ok = true;
+    s_pending_scan = true;
+    xTaskCreate(ds18b20_task, "ds18b20", 3072, NULL, 3, NULL);
+}
+
+int ds18b20_get(ds18b20_probe_t *probes, int max) {
+    portENTER_CRITICAL(&s_lock);
+    int n = s_count < max ? s_count : max;
+    memcpy(probes, s_probes, sizeof(probes[0]) * n);
+    portEXIT_CRITICAL(&s_lock);
+    return n;
+}
+
+static void print_status(void) {
+    ds18b20_probe_t probes[DS18B20_MAX_PROBES];
+    int n = ds18b20_get(probes, DS18B20_MAX_PROBES);
+    printf("[探头] %d 个 DS18B20，分辨率 %u 位，上次转换 %lu ms (最长 %lu ms)\n",
+           n, s_bits, (unsigned long)s_last_convert_ms, (unsigned long)conversion_ms(s_bits));
+    for (int i = 0; i < n; i++) {
+        const uint8_t *r = probes[i].rom;
+        printf("  %d: %02X%02X%02X%02X%02X%02X%02X%02X  ", i + 1,
+               r[0], r[1], r[2], r[3], r[4], r[5], r[6], r[7]);
+        if (isnan(probes[i].temperature)) printf("--");
+        else printf("%.2f°C", probes[i].temperature);
+        printf("  (错误 %lu)\n", (unsigned long)probes[i].errors);
+    }
+}
+
+void ds18b20_command(const char *args) {
+    char sub[16] = "";
+    unsigned bits;
+    sscanf(args, "%15s", sub);
+
+    if (!s_bus_ok) {
+        printf("[探头] 1-Wire总线不可用\n");
+    } else if (sub[0] == '\0' || strcmp(sub, "status") == 0) {
+        print_status();
+    } else if (strcmp(sub, "scan") == 0) {
+        portENTER_CRITICAL(&s_lock);
+        s_pending_scan = true;
+        portEXIT_CRITICAL(&s_lock);
+        printf("[探头] 将在下个周期重新搜索总线\n");
+    } else if (strcmp(sub, "res") == 0 && sscanf(args, "%*s %u", &bits) == 1) {
+        if (bits < 9 || bits > 12) {
+            printf("[错误] 分辨率范围 9~12 位\n");
+            return;
+        }
+        portENTER_CRITICAL(&s_lock);
+        s_pending_bits = bits;
+        portEXIT_CRITICAL(&s_lock);
+        printf("[探头] 分辨率 %u 位，转换时间约 %lu ms (下个周期生效)\n",
+               bits, (unsigned long)conversion_ms(bits));
+    } else {
+        printf("用法: probe [status|scan|res <9~12>]\n");
+    }
+}
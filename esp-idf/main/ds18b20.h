@@ -0,0 +1,29 @@
+#ifndef DS18B20_H
+#define DS18B20_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// DS18B20 温度探头 (1-Wire总线，见 onewire.h)。
+// 启动时搜索总线上的全部探头；每个周期用一条 SKIP ROM + CONVERT T 让所有探头
+// 同时转换，再逐个读暂存器 (每个探头一次UART收发)，N个探头只花一个转换时间。
+// 分辨率 9~12 位对应转换时间约 94/188/375/750ms，精度 0.5/0.25/0.125/0.0625°C。
+
+#define DS18B20_MAX_PROBES     8
+
+typedef struct {
+    uint8_t rom[8];
+    float temperature;        // °C，未读到为 NAN
+    uint32_t errors;          // 累计读取失败次数
+} ds18b20_probe_t;
+
+// 配置总线、搜索探头并启动采样任务
+void ds18b20_init(void);
+
+// 复制当前探头列表，返回探头数
+int ds18b20_get(ds18b20_probe_t *probes, int max);
+
+// 串口命令 "probe ..." 的参数部分
+void ds18b20_command(const char *args);
+
+#endif
@@ -0,0 +1,249 @@
+#include "lighting.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "power_budget.h"
+#include "pwm.h"
+
+#define LIGHT_PERIOD_MS        10000           // 调度周期，每步用同样时长渐变
+#define LIGHT_SUPPLY_V         5.0f
+#define LIGHT_VALID_YEAR       2024            // 早于此年份视为时间未设置
+
+// 满亮度时冠层处的光合光子通量密度 (µmol/m²/s)，按实测调整
+#define LIGHT_PPFD_FULL        250.0f
+// 平台亮度下限：再暗对植物已无意义，宁可略超DLI
+#define LIGHT_MIN_DUTY         0.20f
+
+#define LIGHT_DEFAULT_ON_MIN   (6 * 60)        // 06:00 开灯
+#define LIGHT_DEFAULT_HOURS    16
+#define LIGHT_DEFAULT_RAMP     30
+#define LIGHT_DEFAULT_DLI      12.0f
+#define LIGHT_DEFAULT_MAX      1.0f
+
+#define DAY_SECONDS            86400
+
+static pwm_out_t s_led_pwm;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static light_status_t s_status;
+static float s_manual_duty = 0.0f;
+static int32_t s_last_t = -1;          // 上一步在光周期中的位置，只在调度任务中访问
+
+static float clampf(float v, float lo, float hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static float led_watts(void) {
+    return board_actuators[ACT_LED].current_ma * LIGHT_SUPPLY_V / 1000.0f;
+}
+
+// 光周期内第 t 秒的渐变系数 (0~1)
+static float ramp_factor(int32_t t, int32_t period_s, int32_t ramp_s) {
+    if (t < 0 || t >= period_s) return 0.0f;
+    if (ramp_s <= 0) return 1.0f;
+    float up = (float)t / ramp_s;
+    float down = (float)(period_s - t) / ramp_s;
+    return clampf(up < down ? up : down, 0.0f, 1.0f);
+}
+
+// 从第 t 秒到光周期结束，按渐变系数折算的满亮度等效秒数
+static float remaining_equivalent_s(int32_t t, int32_t period_s, int32_t ramp_s) {
+    float sum = 0.0f;
+    for (int32_t s = t; s < period_s; s += 60) {
+        int32_t step = period_s - s < 60 ? period_s - s : 60;
+        sum += ramp_factor(s + step / 2, period_s, ramp_s) * step;
+    }
+    return sum;
+}
+
+// 平台亮度：把剩余DLI平均分到剩余的光照时间上
+static float plateau_duty(const light_status_t *st, int32_t t, int32_t period_s, int32_t ramp_s) {
+    float remaining_mol = st->target_dli - st->dli;
+    float equiv_s = remaining_equivalent_s(t, period_s, ramp_s);
+    if (remaining_mol <= 0.0f || equiv_s <= 0.0f) return LIGHT_MIN_DUTY;
+    float duty = remaining_mol * 1e6f / (LIGHT_PPFD_FULL * equiv_s);
+    return clampf(duty, LIGHT_MIN_DUTY, st->max_duty);
+}
+
+static float apply_output(float duty, uint32_t fade_ms) {
+    if (duty <= 0.0f) {
+        power_budget_release(ACT_LED);
+        duty = 0.0f;
+    } else if (!power_budget_request(ACT_LED)) {
+        pwm_set(&s_led_pwm, 0.0f);   // 排队等待电源预算，或预算被收回：立即关断
+        return 0.0f;
+    }
+    if (duty != pwm_get(&s_led_pwm)) pwm_fade(&s_led_pwm, duty, fade_ms);
+    return duty;
+}
+
+static void lighting_step(float dt) {
+    time_t now = time(NULL);
+    struct tm local;
+    localtime_r(&now, &local);
+
+    portENTER_CRITICAL(&s_lock);
+    light_status_t st = s_status;
+    float manual = s_manual_duty;
+    portEXIT_CRITICAL(&s_lock);
+
+    // 上一步的输出计入光量与能耗
+    float dli_add = LIGHT_PPFD_FULL * st.duty * dt / 1e6f;
+    float wh_add = led_watts() * st.duty * dt / 3600.0f;
+
+    bool time_valid = local.tm_year + 1900 >= LIGHT_VALID_YEAR;
+    int32_t period_s = st.photoperiod_h * 3600;
+    int32_t ramp_s = st.ramp_min * 60;
+    int32_t now_s = local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec;
+    int32_t t = (now_s - st.on_minute * 60 + DAY_SECONDS) % DAY_SECONDS;
+    bool daytime = time_valid && t < period_s;
+
+    // 进入光周期，或在开灯时刻回绕 (24小时光照时 daytime 一直为真)
+    bool wrapped = s_last_t >= 0 && t + DAY_SECONDS / 2 < s_last_t;
+    bool new_period = daytime && (!st.daytime || wrapped);
+    s_last_t = time_valid ? t : -1;
+    float plateau = st.plateau_duty;
+    float target = 0.0f;
+    if (st.mode == LIGHT_MANUAL) {
+        target = manual;
+    } else if (st.mode == LIGHT_AUTO && daytime) {
+        light_status_t next = st;
+        if (new_period) next.dli = 0.0f;
+        else next.dli += dli_add;
+        plateau = plateau_duty(&next, t, period_s, ramp_s);
+        target = plateau * ramp_factor(t, period_s, ramp_s);
+    }
+    float duty = apply_output(target, LIGHT_PERIOD_MS);
+
+    portENTER_CRITICAL(&s_lock);
+    if (new_period) {
+        // 新的光周期开始：保存上一周期的统计
+        s_status.last_dli = s_status.dli;
+        s_status.last_energy_wh = s_status.energy_wh;
+        s_status.dli = 0.0f;
+        s_status.energy_wh = 0.0f;
+    } else {
+        s_status.dli += dli_add;
+        s_status.energy_wh += wh_add;
+    }
+    s_status.time_valid = time_valid;
+    s_status.daytime = daytime;
+    s_status.plateau_duty = plateau;
+    s_status.duty = duty;
+    s_status.full_energy_wh = led_watts() * st.photoperiod_h;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+static void lighting_task(void *arg) {
+    int64_t last_us = esp_timer_get_time();
+    while (1) {
+        int64_t now_us = esp_timer_get_time();
+        lighting_step((now_us - last_us) / 1e6f);
+        last_us = now_us;
+        vTaskDelay(pdMS_TO_TICKS(LIGHT_PERIOD_MS));
+    }
+}
+
+void lighting_init(void) {
+    pwm_init(&s_led_pwm, GPIO_PIN_LED, PWM_CH_LED, PWM_TIMER_POWER, PWM_FREQ_POWER);
+
+    memset(&s_status, 0, sizeof(s_status));
+    s_status.mode = LIGHT_AUTO;
+    s_status.on_minute = LIGHT_DEFAULT_ON_MIN;
+    s_status.photoperiod_h = LIGHT_DEFAULT_HOURS;
+    s_status.ramp_min = LIGHT_DEFAULT_RAMP;
+    s_status.target_dli = LIGHT_DEFAULT_DLI;
+    s_status.max_duty = LIGHT_DEFAULT_MAX;
+
+    xTaskCreate(lighting_task, "lighting", 3072, NULL, 3, NULL);
+}
+
+void lighting_set_mode(light_mode_t mode) {
+    portENTER_CRITICAL(&s_lock);
+    s_status.mode = mode;
+    s_manual_duty = 0.0f;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void lighting_manual(uint8_t state) {
+    portENTER_CRITICAL(&s_lock);
+    s_status.mode = LIGHT_MANUAL;
+    s_manual_duty = state ? s_status.max_duty : 0.0f;
+    portEXIT_CRITICAL(&s_lock);
+    printf("[补光] 手动模式：led -> %s (下个周期生效，\"light auto\" 恢复调度)\n",
+           state ? "开启" : "关闭");
+}
+
+void lighting_get_status(light_status_t *status) {
+    portENTER_CRITICAL(&s_lock);
+    *status = s_status;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+static void print_status(void) {
+    static const char *mode_names[] = { "关闭", "自动", "手动" };
+    light_status_t st;
+    lighting_get_status(&st);
+    printf("[补光] 模式: %s  %s\n", mode_names[st.mode],
+           !st.time_valid ? "时间未设置 (time 命令)，灯保持关闭" : (st.daytime ? "光周期内" : "暗期"));
+    printf("[补光] %02u:%02u 开灯，光照 %u 小时，渐变 %u 分钟，最高亮度 %.0f%%\n",
+           st.on_minute / 60, st.on_minute % 60, st.photoperiod_h, st.ramp_min, st.max_duty * 100);
+    printf("[补光] 当前亮度 %.0f%%  平台亮度 %.0f%%\n", st.duty * 100, st.plateau_duty * 100);
+    printf("[补光] DLI %.2f / %.1f mol/m²  (上一周期 %.2f)\n", st.dli, st.target_dli, st.last_dli);
+    printf("[补光] 能耗 %.1f Wh (上一周期 %.1f Wh，满亮度约 %.1f Wh)\n",
+           st.energy_wh, st.last_energy_wh, st.full_energy_wh);
+}
+
+void lighting_command(const char *args) {
+    char sub[16] = "";
+    unsigned hh, mm, hours, ramp;
+    float value;
+    sscanf(args, "%15s", sub);
+
+    if (sub[0] == '\0' || strcmp(sub, "status") == 0) {
+        print_status();
+    } else if (strcmp(sub, "auto") == 0) {
+        lighting_set_mode(LIGHT_AUTO);
+        printf("[补光] 光周期调度已开启\n");
+    } else if (strcmp(sub, "off") == 0) {
+        lighting_set_mode(LIGHT_OFF);
+        printf("[补光] 已关闭\n");
+    } else if (strcmp(sub, "set") == 0 &&
+               sscanf(args, "%*s %u:%u %u %u", &hh, &mm, &hours, &ramp) == 4) {
+        if (hh > 23 || mm > 59 || hours < 1 || hours > 24 || ramp * 2 > hours * 60) {
+            printf("[错误] 参数超出范围\n");
+            return;
+        }
+        portENTER_CRITICAL(&s_lock);
+        s_status.on_minute = hh * 60 + mm;
+        s_status.photoperiod_h = hours;
+        s_status.ramp_min = ramp;
+        portEXIT_CRITICAL(&s_lock);
+        printf("[补光] %02u:%02u 开灯，光照 %u 小时，渐变 %u 分钟\n", hh, mm, hours, ramp);
+    } else if (strcmp(sub, "dli") == 0 && sscanf(args, "%*s %f", &value) == 1) {
+        if (value <= 0.0f || value > 60.0f) {
+            printf("[错误] DLI 范围 0~60 mol/m²\n");
+            return;
+        }
+        portENTER_CRITICAL(&s_lock);
+        s_status.target_dli = value;
+        portEXIT_CRITICAL(&s_lock);
+        printf("[补光] 目标 DLI %.1f mol/m²\n", value);
+    } else if (strcmp(sub, "max") == 0 && sscanf(args, "%*s %f", &value) == 1) {
+        if (value < LIGHT_MIN_DUTY * 100 || value > 100.0f) {
+            printf("[错误] 最高亮度范围 %.0f~100%%\n", LIGHT_MIN_DUTY * 100);
+            return;
+        }
+        portENTER_CRITICAL(&s_lock);
+        s_status.max_duty = value / 100.0f;
+        portEXIT_CRITICAL(&s_lock);
+        printf("[补光] 最高亮度 %.0f%%\n", value);
+    } else {
+        printf("用法: light [status|auto|off|set <HH:MM> <小时> <渐变分钟>|dli <mol>|max <百分比>]\n");
+    }
+}
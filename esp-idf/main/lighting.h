@@ -0,0 +1,49 @@
+#ifndef LIGHTING_H
+#define LIGHTING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "board.h"
+
+// 补光灯光周期调度：按系统时间在每天固定时刻开灯，日出/日落时PWM渐变，
+// 并估算日累计光照量 (DLI, mol/m²/天)。白天平台亮度按剩余光照需求
+// 自适应调整：光周期不变，只把当天的光量控制在目标附近，从而控制能耗。
+
+typedef enum {
+    LIGHT_OFF,
+    LIGHT_AUTO,
+    LIGHT_MANUAL,     // 串口 "led 0|1" 直接给定
+} light_mode_t;
+
+typedef struct {
+    light_mode_t mode;
+    bool time_valid;          // 系统时间已设置
+    bool daytime;             // 处于光周期内
+    uint16_t on_minute;       // 开灯时刻 (当天第几分钟)
+    uint8_t photoperiod_h;
+    uint16_t ramp_min;        // 日出/日落渐变时长，最长为光周期的一半
+    float target_dli;         // mol/m²/天
+    float max_duty;
+    float duty;               // 当前输出
+    float plateau_duty;       // 当前计算的白天平台亮度
+    float dli;                // 本光周期已累计
+    float last_dli;           // 上一光周期
+    float energy_wh;          // 本光周期
+    float last_energy_wh;
+    float full_energy_wh;     // 满亮度运行整个光周期的能耗，用于比较
+} light_status_t;
+
+// 初始化PWM并启动调度任务
+void lighting_init(void);
+
+void lighting_set_mode(light_mode_t mode);
+
+// 手动开关 (切换到手动模式)
+void lighting_manual(uint8_t state);
+
+void lighting_get_status(light_status_t *status);
+
+// 串口命令 "light ..." 的参数部分
+void lighting_command(const char *args);
+
+#endif
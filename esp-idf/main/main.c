@@ -1,119 +1,183 @@
 #include <stdio.h>          // 标准输入输出，用于printf
 #include <string.h>         // 字符串操作，用于命令解析
+#include <sys/time.h>       // settimeofday，补光调度使用系统时间
+#include <time.h>
 #include "driver/gpio.h"    // ESP32 GPIO驱动库
 #include "freertos/FreeRTOS.h"   // FreeRTOS内核
 #include "freertos/task.h"       // FreeRTOS任务管理
 
 #include "driver/uart.h"
 
-// #include "driver/adc.h"           // 用于土壤湿度传感器ADC
-// #include "ds18b20.h"              // DS18B20温度传感器库 (需另外安装)
+#include "board.h"
+#include "climate.h"
+#include "ds18b20.h"
+#include "lighting.h"
+#include "power_budget.h"
+#include "soil.h"
 
-#define GPIO_PIN_PUMP          GPIO_NUM_4     // 蠕动泵控制引脚 (通过IRFZ44N)
-#define GPIO_PIN_FAN           GPIO_NUM_5     // 散热风扇控制引脚 (通过2N7000)
-#define GPIO_PIN_LED           GPIO_NUM_6     // LED灯组控制引脚 (通过IRFZ44N)
-#define GPIO_PIN_TEC           GPIO_NUM_7     // TEC半导体制冷片控制引脚 (通过IRFZ44N)
-#define GPIO_PIN_SENSOR_POWER  GPIO_NUM_8     // 土壤湿度传感器电源控制 (通过SS8050)
+// 引脚与执行器定义见 board.h
 
 // 串口输入缓冲区
 #define INPUT_BUFFER_SIZE      64
 
+// 电源预算 (按5V/3A电源估算，实测后调整)。执行器表的电流之和超出预算：
+// TEC 2000 + LED 800 + 风扇 150 = 2950 mA，TEC 与补光灯不会同时开启，
+// TEC 优先，最多等30秒后收回补光灯的预算；泵 400 + TEC + 风扇 = 2550 mA，
+// 浇水时立即收回 TEC 的预算，浇完后 TEC 自动恢复
+#define POWER_BUDGET_MA        2500
+#define POWER_SOFTSTART_MS     200     // 两次开启之间的浪涌间隔
+#define POWER_TICK_MS          50
+
 /* ========== 3. 函数声明 ========== */
 // 硬件初始化函数
 static void hardware_init(void);
 
 // 执行器控制函数 (你的"_"命名规范)
-static void mosfet_control(gpio_num_t pin, uint8_t state);
-static void bjt_control(gpio_num_t pin, uint8_t state);
+static void mosfet_control(board_actuator_id_t id, uint8_t state);
 
 // 串口命令处理函数
 static void process_command(char* cmd);
 
 /* ========== 4. 函数实现 ========== */
 static void hardware_init(void) {
-    // 1. 配置控制执行器的GPIO (MOSFET驱动)
-    gpio_config_t io_conf = {
-        .pin_bit_mask = (1ULL << GPIO_PIN_PUMP) | 
-                        (1ULL << GPIO_PIN_FAN) | 
-                        (1ULL << GPIO_PIN_LED) | 
-                        (1ULL << GPIO_PIN_TEC),
-        .mode = GPIO_MODE_OUTPUT,          // 输出模式
-        .pull_up_en = GPIO_PULLUP_DISABLE, // 禁用上拉
-        .pull_down_en = GPIO_PULLDOWN_DISABLE, // 禁用下拉
-        .intr_type = GPIO_INTR_DISABLE     // 禁用中断
-    };
-    gpio_config(&io_conf);
-
-    // 2. 配置控制传感器的GPIO (三极管驱动)
-    gpio_config_t sensor_power_conf = {
-        .pin_bit_mask = (1ULL << GPIO_PIN_SENSOR_POWER),
-        .mode = GPIO_MODE_OUTPUT,
-        .pull_up_en = GPIO_PULLUP_DISABLE,
-        .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .intr_type = GPIO_INTR_DISABLE
-    };
-    gpio_config(&sensor_power_conf);
-
-    gpio_set_level(GPIO_PIN_PUMP, 0);
-    gpio_set_level(GPIO_PIN_FAN, 0);
-    gpio_set_level(GPIO_PIN_LED, 0);
-    gpio_set_level(GPIO_PIN_TEC, 0);
-    gpio_set_level(GPIO_PIN_SENSOR_POWER, 0); // 传感器默认断电
+    // 1. 按板级表配置全部GPIO，执行器与传感器电源默认关闭
+    board_init();
+
+    // 2. 登记MOSFET执行器电流，开启时由电源预算统一调度
+    power_budget_init(POWER_BUDGET_MA, POWER_SOFTSTART_MS);
+    for (int i = 0; i < ACT_COUNT; i++) {
+        const board_actuator_t *a = &board_actuators[i];
+        if (a->drive == DRIVE_MOSFET || a->drive == DRIVE_PWM) {
+            power_budget_register((board_actuator_id_t)i, a->current_ma, a->priority);
+        }
+    }
 
     printf("[硬件] 初始化完成，所有执行器已关闭。\n");
 }
 
-static void mosfet_control(gpio_num_t pin, uint8_t state) {
-    if (state == 0 || state == 1) {
-        gpio_set_level(pin, state);
-        printf("[MOSFET控制] GPIO_%d -> %s\n", pin, state ? "开启" : "关闭");
+// 状态已由 process_command 检查为0或1
+static void mosfet_control(board_actuator_id_t id, uint8_t state) {
+    const board_actuator_t *a = &board_actuators[id];
+    if (state == 1) {
+        if (power_budget_request(id)) {
+            printf("[MOSFET控制] %s (GPIO_%d) -> 开启\n", a->command, a->pin);
+        } else {
+            printf("[MOSFET控制] %s (GPIO_%d) -> 等待电源预算 (已用 %u mA)\n",
+                   a->command, a->pin, power_budget_used_ma());
+        }
     } else {
-        printf("[错误] 无效的控制状态: %d (只能为0或1)\n", state);
+        power_budget_release(id);
+        printf("[MOSFET控制] %s (GPIO_%d) -> 关闭\n", a->command, a->pin);
     }
 }
 
-static void bjt_control(gpio_num_t pin, uint8_t state) {
-    if (state == 0 || state == 1) {
-        gpio_set_level(pin, state);
-        printf("[三极管控制] 传感器电源 GPIO_%d -> %s\n", pin, state ? "上电" : "断电");
-        
-        if (state == 1) {
-            vTaskDelay(pdMS_TO_TICKS(50)); // 50ms稳定时间
-        }
+static void actuator_control(board_actuator_id_t id, uint8_t state) {
+    if (id == ACT_TEC || id == ACT_FAN) {
+        climate_manual(id, state);   // PWM输出归温控管理
+    } else if (id == ACT_LED) {
+        lighting_manual(state);      // PWM输出归补光调度管理
+    } else if (id == ACT_SENSOR) {
+        soil_manual(state);          // 探头电源归土壤突发采样管理
     } else {
-        printf("[错误] 无效的控制状态: %d\n", state);
+        mosfet_control(id, state);
     }
 }
 
+// 按命令表列出设备名
+static void print_devices(void) {
+    for (int i = 0; i < ACT_COUNT; i++) {
+        printf("%s, ", board_actuators[i].command);
+    }
+    printf("all\n");
+}
+
+// "time YYYY-MM-DD HH:MM[:SS]"：设置系统时间 (本地时间)
+static void time_command(const char *args) {
+    struct tm tm = {0};
+    int year, month, day, hour, minute, second = 0;
+    if (sscanf(args, "%d-%d-%d %d:%d:%d", &year, &month, &day, &hour, &minute, &second) >= 5) {
+        tm.tm_year = year - 1900;
+        tm.tm_mon = month - 1;
+        tm.tm_mday = day;
+        tm.tm_hour = hour;
+        tm.tm_min = minute;
+        tm.tm_sec = second;
+        tm.tm_isdst = -1;
+        time_t t = mktime(&tm);
+        if (t < 0 || month < 1 || month > 12 || day < 1 || day > 31 ||
+            hour > 23 || minute > 59 || second > 59) {
+            printf("[错误] 无效的时间\n");
+            return;
+        }
+        struct timeval tv = { .tv_sec = t, .tv_usec = 0 };
+        settimeofday(&tv, NULL);
+    } else if (args[strspn(args, " ")] != '\0') {
+        printf("用法: time [YYYY-MM-DD HH:MM[:SS]]\n");
+        return;
+    }
+
+    time_t now = time(NULL);
+    struct tm local;
+    localtime_r(&now, &local);
+    printf("[时间] %04d-%02d-%02d %02d:%02d:%02d\n", local.tm_year + 1900, local.tm_mon + 1,
+           local.tm_mday, local.tm_hour, local.tm_min, local.tm_sec);
+}
+
+// 带参数的子系统命令，其余按 "<设备> <状态>" 解析
+typedef struct {
+    const char *name;
+    void (*handler)(const char *args);
+} text_command_t;
+
+static const text_command_t s_text_commands[] = {
+    { "climate", climate_command },
+    { "light",   lighting_command },
+    { "probe",   ds18b20_command },
+    { "soil",    soil_command },
+    { "time",    time_command },
+};
+
 static void process_command(char* cmd) {
     char device[16];
     int state;
+
+    for (size_t i = 0; i < sizeof(s_text_commands) / sizeof(s_text_commands[0]); i++) {
+        size_t n = strlen(s_text_commands[i].name);
+        if (strncmp(cmd, s_text_commands[i].name, n) == 0 && (cmd[n] == '\0' || cmd[n] == ' ')) {
+            s_text_commands[i].handler(cmd + n);
+            return;
+        }
+    }
     
     if (sscanf(cmd, "%15s %d", device, &state) == 2) {
         device[strcspn(device, "\r\n")] = 0;
+
+        if (state != 0 && state != 1) {
+            printf("[错误] 无效的控制状态: %d (只能为0或1)\n", state);
+            return;
+        }
         
-        // 根据设备名调用对应的控制函数
-        if (strcmp(device, "pump") == 0) {
-            mosfet_control(GPIO_PIN_PUMP, state);
-        } else if (strcmp(device, "fan") == 0) {
-            mosfet_control(GPIO_PIN_FAN, state);
-        } else if (strcmp(device, "led") == 0) {
-            mosfet_control(GPIO_PIN_LED, state);
-        } else if (strcmp(device, "tec") == 0) {
-            mosfet_control(GPIO_PIN_TEC, state);
-        } else if (strcmp(device, "sensor") == 0) {
-            bjt_control(GPIO_PIN_SENSOR_POWER, state);
-        } else if (strcmp(device, "all") == 0) {
-            // 特殊命令: 控制所有执行器
-            mosfet_control(GPIO_PIN_PUMP, state);
-            mosfet_control(GPIO_PIN_FAN, state);
-            mosfet_control(GPIO_PIN_LED, state);
-            mosfet_control(GPIO_PIN_TEC, state);
+        if (strcmp(device, "all") == 0) {
+            // 特殊命令: 控制所有MOSFET执行器
+            for (int i = 0; i < ACT_COUNT; i++) {
+                if (board_actuators[i].drive == DRIVE_MOSFET || board_actuators[i].drive == DRIVE_PWM) {
+                    actuator_control((board_actuator_id_t)i, state);
+                }
+            }
             printf("[全局控制] 所有执行器已%s\n", state ? "开启" : "关闭");
-        } else {
-            printf("[错误] 未知设备: %s\n", device);
-            printf("可用设备: pump, fan, led, tec, sensor, all\n");
+            return;
+        }
+
+        // 在命令表中查找设备名
+        for (int i = 0; i < ACT_COUNT; i++) {
+            if (strcmp(device, board_actuators[i].command) == 0) {
+                actuator_control((board_actuator_id_t)i, state);
+                return;
+            }
         }
+        printf("[错误] 未知设备: %s\n", device);
+        printf("可用设备: ");
+        print_devices();
     } else {
         printf("[错误] 命令格式无效。请使用: \"设备 状态\"\n");
         printf("示例: \"pump 1\" 或 \"fan 0\"\n");
@@ -191,8 +255,12 @@ void app_main(void) {
     printf("  ESP32-C6 + ESP-IDF (USB控制台模式)\n");
     printf("=========================================\n\n");
 
-    // 1. 初始化硬件
+    // 1. 初始化硬件、温控、补光、温度探头与土壤探头
     hardware_init();
+    climate_init();
+    lighting_init();
+    ds18b20_init();
+    soil_init();
 
     printf("[系统] 硬件初始化完成，所有执行器已关闭。\n");
     printf("[系统] 正在启动命令接收任务...\n");
@@ -217,14 +285,23 @@ void app_main(void) {
     printf("[系统] 命令处理任务已启动。\n");
     printf("[系统] 等待串口命令输入...\n");
     printf("[命令格式] <设备> <状态>\n");
-    printf("[可用设备] pump, fan, led, tec, sensor, all\n");
+    printf("[可用设备] ");
+    print_devices();
     printf("[状态] 0=关闭, 1=开启\n");
     printf("示例: 开启蠕动泵 -> \"pump 1\"\n");
-    printf("      关闭所有设备 -> \"all 0\"\n\n");
+    printf("      关闭所有设备 -> \"all 0\"\n");
+    printf("[温控] climate [status|auto|off|set <温度> <湿度>|reset]\n");
+    printf("       tec/fan 命令切换到手动模式\n");
+    printf("[补光] light [status|auto|off|set <HH:MM> <小时> <渐变分钟>|dli <mol>|max <百分比>]\n");
+    printf("       led 命令切换到手动模式；先用 time YYYY-MM-DD HH:MM 设置时间\n");
+    printf("[探头] probe [status|scan|res <9~12>]\n");
+    printf("[土壤] soil [status|now|period <秒>|settle <毫秒>]\n");
+    printf("       sensor 1 让探头电源常开，sensor 0 恢复突发采样\n\n");
 
-    // 3. 主任务可以进入低功耗循环或执行其他管理功能
+    // 3. 主任务：按电源预算依次开启排队中的执行器
     while (1) {
         // 这里可以添加系统状态监测、看门狗喂食等
-        vTaskDelay(pdMS_TO_TICKS(1000)); // 每1秒循环一次，让出CPU
+        power_budget_tick();
+        vTaskDelay(pdMS_TO_TICKS(POWER_TICK_MS));
     }
 }
@@ -0,0 +1,147 @@
+#include "onewire.h"
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+
+#define OW_BAUD_RESET     9600
+#define OW_BAUD_DATA      115200
+#define OW_SLOT_ONE       0xFF     // 写1或读时隙；回读为0xFF表示读到1
+#define OW_SLOT_ZERO      0x00
+#define OW_TIMEOUT_MS     10       // 另加每字节约0.1ms的传输时间
+
+// 发出 len 个UART字节，并等回读的同样数量的字节
+static esp_err_t uart_exchange(const onewire_bus_t *bus, const uint8_t *tx, uint8_t *rx, size_t len) {
+    uart_flush_input(bus->port);
+    if (uart_write_bytes(bus->port, tx, len) != (int)len) return ESP_FAIL;
+    int n = uart_read_bytes(bus->port, rx, len, pdMS_TO_TICKS(OW_TIMEOUT_MS + len / 10));
+    return n == (int)len ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t onewire_init(onewire_bus_t *bus, uart_port_t port, gpio_num_t pin) {
+    const uart_config_t conf = {
+        .baud_rate = OW_BAUD_DATA,
+        .data_bits = UART_DATA_8_BITS,
+        .parity = UART_PARITY_DISABLE,
+        .stop_bits = UART_STOP_BITS_1,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .source_clk = UART_SCLK_DEFAULT,
+    };
+    bus->port = port;
+    esp_err_t err = uart_driver_install(port, 256, 0, 0, NULL, 0);
+    if (err == ESP_OK) err = uart_param_config(port, &conf);
+    if (err == ESP_OK) err = uart_set_pin(port, pin, pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    if (err != ESP_OK) return err;
+    // TX与RX共用引脚：只把焊盘改为开漏并上拉，器件才能把总线拉低。
+    // 不能再调 gpio_set_direction：它会把焊盘输出改接回GPIO输出寄存器，断开UART TX
+    gpio_od_enable(pin);
+    gpio_pullup_en(pin);
+    return ESP_OK;
+}
+
+esp_err_t onewire_reset(const onewire_bus_t *bus) {
+    uint8_t tx = 0xF0, rx = 0;
+    uart_set_baudrate(bus->port, OW_BAUD_RESET);
+    esp_err_t err = uart_exchange(bus, &tx, &rx, 1);
+    uart_set_baudrate(bus->port, OW_BAUD_DATA);
+    if (err != ESP_OK) return err;
+    if (rx == 0xF0) return ESP_ERR_NOT_FOUND;      // 没有应答脉冲
+    if (rx == 0x00) return ESP_ERR_INVALID_STATE;  // 总线一直为低：短路或缺上拉
+    return ESP_OK;
+}
+
+esp_err_t onewire_transfer(const onewire_bus_t *bus, const uint8_t *tx, size_t tx_len,
+                           uint8_t *rx, size_t rx_len) {
+    uint8_t slots[ONEWIRE_MAX_TRANSFER * 8];
+    size_t len = tx_len + rx_len;
+    if (len > ONEWIRE_MAX_TRANSFER) return ESP_ERR_INVALID_ARG;
+
+    // 低位先发；读的部分全部发读时隙
+    for (size_t i = 0; i < len * 8; i++) {
+        bool one = i >= tx_len * 8 || (tx[i / 8] >> (i % 8)) & 1;
+        slots[i] = one ? OW_SLOT_ONE : OW_SLOT_ZERO;
+    }
+    esp_err_t err = uart_exchange(bus, slots, slots, len * 8);
+    if (err != ESP_OK) return err;
+
+    for (size_t i = 0; i < rx_len; i++) {
+        uint8_t byte = 0;
+        for (int b = 0; b < 8; b++) {
+            if (slots[(tx_len + i) * 8 + b] == OW_SLOT_ONE) byte |= 1 << b;
+        }
+        rx[i] = byte;
+    }
+    return ESP_OK;
+}
+
+esp_err_t onewire_read_bit(const onewire_bus_t *bus, bool *bit) {
+    uint8_t slot = OW_SLOT_ONE;
+    esp_err_t err = uart_exchange(bus, &slot, &slot, 1);
+    *bit = slot == OW_SLOT_ONE;
+    return err;
+}
+
+void onewire_search_start(onewire_search_t *search) {
+    memset(search->rom, 0, sizeof(search->rom));
+    search->last_discrepancy = -1;
+    search->last_device = false;
+}
+
+// Maxim AN187 的二叉树搜索：每位读 id/反码两个时隙，再写出所选方向
+esp_err_t onewire_search_next(const onewire_bus_t *bus, onewire_search_t *search, uint8_t rom[8]) {
+    if (search->last_device) return ESP_ERR_NOT_FOUND;
+
+    esp_err_t err = onewire_reset(bus);
+    if (err != ESP_OK) return err;
+    uint8_t cmd = ONEWIRE_CMD_SEARCH_ROM;
+    err = onewire_transfer(bus, &cmd, 1, NULL, 0);
+    if (err != ESP_OK) return err;
+
+    int last_zero = -1;
+    for (int bit = 0; bit < 64; bit++) {
+        uint8_t slots[2] = { OW_SLOT_ONE, OW_SLOT_ONE };
+        err = uart_exchange(bus, slots, slots, 2);
+        if (err != ESP_OK) return err;
+        bool id = slots[0] == OW_SLOT_ONE;
+        bool cmp = slots[1] == OW_SLOT_ONE;
+        if (id && cmp) return ESP_ERR_NOT_FOUND;   // 无器件应答
+
+        bool dir;
+        if (id != cmp) {
+            dir = id;                              // 所有器件此位相同
+        } else {
+            // 分歧：先走0分支，之前走过0的位置这次改走1
+            if (bit < search->last_discrepancy) {
+                dir = (search->rom[bit / 8] >> (bit % 8)) & 1;
+            } else {
+                dir = bit == search->last_discrepancy;
+            }
+            if (!dir) last_zero = bit;
+        }
+        if (dir) search->rom[bit / 8] |= 1 << (bit % 8);
+        else search->rom[bit / 8] &= ~(1 << (bit % 8));
+
+        uint8_t slot = dir ? OW_SLOT_ONE : OW_SLOT_ZERO;
+        err = uart_exchange(bus, &slot, &slot, 1);
+        if (err != ESP_OK) return err;
+    }
+
+    search->last_discrepancy = last_zero;
+    search->last_device = last_zero < 0;
+    if (onewire_crc8(search->rom, 8) != 0) return ESP_ERR_INVALID_CRC;
+    memcpy(rom, search->rom, 8);
+    return ESP_OK;
+}
+
+uint8_t onewire_crc8(const uint8_t *data, size_t len) {
+    uint8_t crc = 0;
+    while (len--) {
+        uint8_t byte = *data++;
+        for (int b = 0; b < 8; b++) {
+            uint8_t mix = (crc ^ byte) & 1;
+            crc >>= 1;
+            if (mix) crc ^= 0x8C;
+            byte >>= 1;
+        }
+    }
+    return crc;
+}
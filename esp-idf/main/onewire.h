@@ -0,0 +1,53 @@
+#ifndef ONEWIRE_H
+#define ONEWIRE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "driver/gpio.h"
+#include "driver/uart.h"
+#include "esp_err.h"
+
+// 用UART产生1-Wire时序：复位脉冲以9600波特率发送0xF0，
+// 每个数据位以115200波特率发送一个字节 (0xFF 写1或读，0x00 写0)，
+// 回读的字节即总线上的实际电平。时序由UART硬件保证，不需要关中断。
+// TX与RX接在同一引脚 (开漏，外接4.7k上拉)，传感器需外部供电 (非寄生供电)。
+
+#define ONEWIRE_CMD_SEARCH_ROM   0xF0
+#define ONEWIRE_CMD_MATCH_ROM    0x55
+#define ONEWIRE_CMD_SKIP_ROM     0xCC
+
+#define ONEWIRE_MAX_TRANSFER     24      // 单次收发的最大字节数 (写+读)
+
+typedef struct {
+    uart_port_t port;
+} onewire_bus_t;
+
+// ROM搜索状态，onewire_search_start 后反复调用 onewire_search_next
+typedef struct {
+    uint8_t rom[8];
+    int last_discrepancy;
+    bool last_device;
+} onewire_search_t;
+
+esp_err_t onewire_init(onewire_bus_t *bus, uart_port_t port, gpio_num_t pin);
+
+// 复位并检测应答脉冲：ESP_OK 有器件，ESP_ERR_NOT_FOUND 无器件
+esp_err_t onewire_reset(const onewire_bus_t *bus);
+
+// 在一次UART收发中先写 tx_len 字节再读 rx_len 字节 (两者之和不超过 ONEWIRE_MAX_TRANSFER)
+esp_err_t onewire_transfer(const onewire_bus_t *bus, const uint8_t *tx, size_t tx_len,
+                           uint8_t *rx, size_t rx_len);
+
+// 读一个时隙：外部供电的器件在忙 (如温度转换中) 时回0，空闲回1
+esp_err_t onewire_read_bit(const onewire_bus_t *bus, bool *bit);
+
+void onewire_search_start(onewire_search_t *search);
+
+// 找到下一个器件时写入 rom 并返回 ESP_OK，已无更多器件返回 ESP_ERR_NOT_FOUND
+esp_err_t onewire_search_next(const onewire_bus_t *bus, onewire_search_t *search, uint8_t rom[8]);
+
+// Dallas/Maxim CRC8 (多项式 x^8+x^5+x^4+1)，含CRC字节一起计算时结果为0
+uint8_t onewire_crc8(const uint8_t *data, size_t len);
+
+#endif
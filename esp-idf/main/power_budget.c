@@ -0,0 +1,200 @@
+#include "power_budget.h"
+
+#include <stdio.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+// 高优先级请求排队超过此时长，收回低优先级执行器的预算让它先开启。
+// 只用于温控与补光之间，以免互相频繁抢占；优先级为 POWER_URGENT_PRIORITY
+// 的请求 (泵) 立即收回，浇水按电源允许的最快速度完成
+#define POWER_PREEMPT_WAIT_MS  30000
+#define POWER_URGENT_PRIORITY  0
+
+// 以执行器编号为下标，无需按引脚查找
+typedef struct {
+    uint16_t current_ma;
+    uint8_t priority;
+} power_actuator_t;
+
+static power_actuator_t s_actuators[ACT_COUNT];
+static uint32_t s_registered_mask = 0;
+static uint32_t s_on_mask = 0;       // 已开启
+static uint32_t s_pending_mask = 0;  // 排队中
+static uint32_t s_revoke_mask = 0;   // 已收回，等持有者下次请求时关断 (电流仍计入)
+static int64_t s_pending_since_us[ACT_COUNT];
+
+static uint16_t s_budget_ma = 0;
+static uint16_t s_spacing_ms = 0;
+static uint16_t s_used_ma = 0;
+static int64_t s_last_start_us = 0;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// DRIVE_PWM 执行器的引脚已交给LEDC，GPIO写无效；其输出由所属模块
+// 按请求结果设定，这里只切换GPIO直接驱动的执行器
+static void switch_output(int i, bool on) {
+    if (board_actuators[i].drive != DRIVE_PWM) board_actuator_set((board_actuator_id_t)i, on);
+}
+
+static uint32_t preempt_wait_ms(uint8_t priority) {
+    return priority <= POWER_URGENT_PRIORITY ? 0 : POWER_PREEMPT_WAIT_MS;
+}
+
+// 调用者需持有 s_lock
+static bool try_start(int i, int64_t now_us) {
+    if (s_last_start_us != 0 &&
+        now_us - s_last_start_us < (int64_t)s_spacing_ms * 1000) {
+        return false;  // 上一个执行器的浪涌尚未结束
+    }
+    uint16_t draw = s_actuators[i].current_ma;
+    // 单个执行器超过总预算时，只允许在其他执行器全部关闭时开启
+    bool fits = (s_used_ma + draw <= s_budget_ma) || (s_on_mask == 0 && draw > s_budget_ma);
+    if (!fits) return false;
+
+    s_on_mask |= (1UL << i);
+    s_pending_mask &= ~(1UL << i);
+    s_used_ma += draw;
+    s_last_start_us = now_us;
+    switch_output(i, true);
+    return true;
+}
+
+// 最高优先级的排队请求等待过久 (见 preempt_wait_ms) 时，从优先级最低的持有者开始收回预算，
+// 直到收回的电流足够它开启；低优先级持有者不够腾出空间时不收回。
+// 调用者需持有 s_lock，返回本次收回的执行器
+static uint32_t preempt_for(int best, int64_t now_us) {
+    uint16_t draw = s_actuators[best].current_ma;
+    uint8_t prio = s_actuators[best].priority;
+    if (now_us - s_pending_since_us[best] < (int64_t)preempt_wait_ms(prio) * 1000) return 0;
+    int32_t need = draw > s_budget_ma ? s_used_ma : (int32_t)s_used_ma + draw - s_budget_ma;
+    int32_t freeable = 0;
+    for (int i = 0; i < ACT_COUNT; i++) {
+        if (!(s_on_mask & (1UL << i))) continue;
+        if (s_revoke_mask & (1UL << i)) need -= s_actuators[i].current_ma;
+        else if (s_actuators[i].priority > prio) freeable += s_actuators[i].current_ma;
+    }
+    if (need <= 0 || freeable < need) return 0;
+
+    uint32_t revoked = 0;
+    while (need > 0) {
+        int worst = -1;
+        for (int i = 0; i < ACT_COUNT; i++) {
+            uint32_t bit = 1UL << i;
+            if ((s_on_mask & bit) && !(s_revoke_mask & bit) && s_actuators[i].priority > prio &&
+                (worst < 0 || s_actuators[i].priority > s_actuators[worst].priority)) {
+                worst = i;
+            }
+        }
+        s_revoke_mask |= (1UL << worst);
+        revoked |= (1UL << worst);
+        need -= s_actuators[worst].current_ma;
+    }
+    return revoked;
+}
+
+void power_budget_init(uint16_t budget_ma, uint16_t spacing_ms) {
+    s_budget_ma = budget_ma;
+    s_spacing_ms = spacing_ms;
+}
+
+void power_budget_register(board_actuator_id_t id, uint16_t current_ma, uint8_t priority) {
+    if (id >= ACT_COUNT) return;
+    s_actuators[id].current_ma = current_ma;
+    s_actuators[id].priority = priority;
+    s_registered_mask |= (1UL << id);
+}
+
+bool power_budget_request(board_actuator_id_t id) {
+    int i = id;
+    if (!(s_registered_mask & (1UL << i))) {
+        board_actuator_set(id, true);  // 未登记的执行器不受预算限制
+        return true;
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    bool started = true;
+    portENTER_CRITICAL(&s_lock);
+    if (s_revoke_mask & (1UL << i)) {
+        // 预算已被收回：此时才真正关断并扣除电流，然后重新排队
+        s_revoke_mask &= ~(1UL << i);
+        s_on_mask &= ~(1UL << i);
+        s_used_ma -= s_actuators[i].current_ma;
+        switch_output(i, false);
+    }
+    if (!(s_on_mask & (1UL << i))) {
+        // 先排队，再由 tick 按优先级决定是否立即开启
+        if (!(s_pending_mask & (1UL << i))) s_pending_since_us[i] = now_us;
+        s_pending_mask |= (1UL << i);
+        started = false;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (!started) {
+        power_budget_tick();
+        started = (s_on_mask & (1UL << i)) != 0;
+    }
+    return started;
+}
+
+void power_budget_release(board_actuator_id_t id) {
+    int i = id;
+    if (!(s_registered_mask & (1UL << i))) {
+        board_actuator_set(id, false);
+        return;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_pending_mask &= ~(1UL << i);
+    s_revoke_mask &= ~(1UL << i);
+    if (s_on_mask & (1UL << i)) {
+        s_on_mask &= ~(1UL << i);
+        s_used_ma -= s_actuators[i].current_ma;
+    }
+    switch_output(i, false);
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void power_budget_tick(void) {
+    int64_t now_us = esp_timer_get_time();
+
+    while (1) {
+        int best = -1;
+        bool started = false;
+        uint16_t used = 0;
+        uint32_t revoked = 0;
+
+        portENTER_CRITICAL(&s_lock);
+        // 选出优先级最高的排队请求；严格按优先级，不让低优先级插队
+        for (int i = 0; i < ACT_COUNT; i++) {
+            if ((s_pending_mask & (1UL << i)) &&
+                (best < 0 || s_actuators[i].priority < s_actuators[best].priority)) {
+                best = i;
+            }
+        }
+        if (best >= 0) {
+            started = try_start(best, now_us);
+            if (!started) revoked = preempt_for(best, now_us);
+            used = s_used_ma;
+        }
+        portEXIT_CRITICAL(&s_lock);
+
+        for (int i = 0; i < ACT_COUNT; i++) {
+            if (!(revoked & (1UL << i))) continue;
+            uint32_t wait_ms = preempt_wait_ms(s_actuators[best].priority);
+            if (wait_ms == 0) {
+                printf("[电源] %s 优先，立即收回 %s 的预算\n", board_actuators[best].command,
+                       board_actuators[i].command);
+            } else {
+                printf("[电源] %s 等待超过 %lu 秒，收回 %s 的预算\n", board_actuators[best].command,
+                       (unsigned long)(wait_ms / 1000), board_actuators[i].command);
+            }
+        }
+        if (!started) break;
+        printf("[电源] %s 已开启 (%u/%u mA)\n",
+               board_actuators[best].command, used, s_budget_ma);
+    }
+}
+
+uint16_t power_budget_used_ma(void) {
+    return s_used_ma;
+}
@@ -0,0 +1,35 @@
+#ifndef POWER_BUDGET_H
+#define POWER_BUDGET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "board.h"
+
+// 执行器电流预算：开启前检查总电流，超出预算的请求进入等待队列，
+// 并保证两次开启之间留出软启动间隔，避免浪涌电流叠加导致掉电复位。
+// 队列严格按优先级：最高优先级的请求未开启前，低优先级请求不会插队。
+// 泵 (优先级0) 排队时立即收回低优先级持有者的预算；其他请求排队超过
+// 30秒才收回，以免长时间占用 (例如白天一直开着的补光灯) 让它无限等待。
+// DRIVE_PWM 执行器的输出由所属模块按本模块的结果设定，这里不写GPIO。
+
+// 初始化预算 (mA) 与软启动间隔 (ms)
+void power_budget_init(uint16_t budget_ma, uint16_t spacing_ms);
+
+// 登记执行器：额定电流 (mA) 与优先级 (数值越小越先开启)
+void power_budget_register(board_actuator_id_t id, uint16_t current_ma, uint8_t priority);
+
+// 请求开启：预算允许则立即开启并返回true，否则排队返回false。
+// 持有者须周期调用：预算被收回后返回false，调用者应立即关断输出，
+// 此后重新排队，预算空出后自动恢复
+bool power_budget_request(board_actuator_id_t id);
+
+// 关闭执行器 (同时取消排队中的请求)
+void power_budget_release(board_actuator_id_t id);
+
+// 周期调用：按优先级开启排队中的执行器
+void power_budget_tick(void);
+
+// 当前占用电流 (mA)
+uint16_t power_budget_used_ma(void);
+
+#endif
@@ -0,0 +1,62 @@
+#include "pwm.h"
+
+#include <stdbool.h>
+
+static bool s_fade_installed = false;
+
+static uint32_t duty_counts(float duty) {
+    if (duty <= 0.0f) return 0;
+    if (duty >= 1.0f) return PWM_DUTY_MAX;
+    return (uint32_t)(duty * PWM_DUTY_MAX + 0.5f);
+}
+
+esp_err_t pwm_init(pwm_out_t *out, gpio_num_t pin, ledc_channel_t channel,
+                   ledc_timer_t timer, uint32_t freq_hz) {
+    ledc_timer_config_t timer_conf = {
+        .speed_mode = LEDC_LOW_SPEED_MODE,   // ESP32-C6 只有低速模式
+        .duty_resolution = PWM_RESOLUTION,
+        .timer_num = timer,
+        .freq_hz = freq_hz,
+        .clk_cfg = LEDC_AUTO_CLK
+    };
+    esp_err_t err = ledc_timer_config(&timer_conf);
+    if (err != ESP_OK) return err;
+
+    ledc_channel_config_t channel_conf = {
+        .gpio_num = pin,
+        .speed_mode = LEDC_LOW_SPEED_MODE,
+        .channel = channel,
+        .intr_type = LEDC_INTR_DISABLE,
+        .timer_sel = timer,
+        .duty = 0,
+        .hpoint = 0
+    };
+    err = ledc_channel_config(&channel_conf);
+    if (err != ESP_OK) return err;
+
+    if (!s_fade_installed) {
+        err = ledc_fade_func_install(0);
+        if (err != ESP_OK) return err;
+        s_fade_installed = true;
+    }
+
+    out->channel = channel;
+    out->duty = 0.0f;
+    return ESP_OK;
+}
+
+void pwm_set(pwm_out_t *out, float duty) {
+    out->duty = duty;
+    ledc_set_duty(LEDC_LOW_SPEED_MODE, out->channel, duty_counts(duty));
+    ledc_update_duty(LEDC_LOW_SPEED_MODE, out->channel);
+}
+
+void pwm_fade(pwm_out_t *out, float duty, uint32_t ms) {
+    if (ms == 0) {
+        pwm_set(out, duty);
+        return;
+    }
+    out->duty = duty;
+    ledc_set_fade_with_time(LEDC_LOW_SPEED_MODE, out->channel, duty_counts(duty), ms);
+    ledc_fade_start(LEDC_LOW_SPEED_MODE, out->channel, LEDC_FADE_NO_WAIT);
+}
@@ -0,0 +1,42 @@
+#ifndef PWM_H
+#define PWM_H
+
+#include <stdint.h>
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+
+// LEDC PWM输出的简单封装，占空比统一用 0.0~1.0 表示。
+// 温控 (TEC/风扇) 与补光灯共用。
+
+#define PWM_RESOLUTION   LEDC_TIMER_10_BIT
+#define PWM_DUTY_MAX     ((1 << 10) - 1)
+
+// 定时器与通道分配
+#define PWM_TIMER_POWER  LEDC_TIMER_0    // TEC、LED：IRFZ44N 由GPIO直驱，频率不宜高
+#define PWM_FREQ_POWER   1000
+#define PWM_TIMER_FAN    LEDC_TIMER_1    // 风扇：25kHz 无可闻噪声
+#define PWM_FREQ_FAN     25000
+#define PWM_CH_TEC       LEDC_CHANNEL_0
+#define PWM_CH_FAN       LEDC_CHANNEL_1
+#define PWM_CH_LED       LEDC_CHANNEL_2
+
+typedef struct {
+    ledc_channel_t channel;
+    float duty;              // 最近一次设置的目标占空比
+} pwm_out_t;
+
+// 配置定时器与通道并输出0占空比；同一定时器可被多个通道共用 (频率需一致)
+esp_err_t pwm_init(pwm_out_t *out, gpio_num_t pin, ledc_channel_t channel,
+                   ledc_timer_t timer, uint32_t freq_hz);
+
+// 立即设置占空比
+void pwm_set(pwm_out_t *out, float duty);
+
+// 在 ms 毫秒内线性渐变到目标占空比 (硬件渐变，不阻塞)
+void pwm_fade(pwm_out_t *out, float duty, uint32_t ms);
+
+static inline float pwm_get(const pwm_out_t *out) {
+    return out->duty;
+}
+
+#endif
@@ -0,0 +1,241 @@
+#include "soil.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "esp_adc/adc_oneshot.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "board.h"
+
+#define SOIL_DEFAULT_PERIOD_S  60
+#define SOIL_DEFAULT_SETTLE_MS 20              // 探头上电后输出稳定时间
+#define SOIL_BURST_SAMPLES     16              // 每通道连续采样点数
+#define SOIL_ATTEN             ADC_ATTEN_DB_12 // 满量程约 3.3V
+#define SOIL_FULL_SCALE_MV     3300            // 无校准数据时按线性估算
+
+static const gpio_num_t s_pins[SOIL_CHANNELS] = { GPIO_PIN_SOIL_1, GPIO_PIN_SOIL_2 };
+
+static adc_oneshot_unit_handle_t s_adc;
+static adc_channel_t s_channels[SOIL_CHANNELS];
+static adc_cali_handle_t s_cali = NULL;
+static bool s_adc_ok = false;
+static TaskHandle_t s_task = NULL;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static soil_reading_t s_reading;
+static uint32_t s_period_s = SOIL_DEFAULT_PERIOD_S;
+static uint32_t s_settle_ms = SOIL_DEFAULT_SETTLE_MS;
+static bool s_manual_on = false;               // 手动上电
+static bool s_burst_on = false;                // 突发采样期间上电
+
+// 须在 s_lock 内调用：任一方需要时探头保持通电
+static void apply_power(void) {
+    board_actuator_set(ACT_SENSOR, s_manual_on || s_burst_on);
+}
+
+static uint16_t raw_to_mv(int raw) {
+    int mv;
+    if (s_cali == NULL || adc_cali_raw_to_voltage(s_cali, raw, &mv) != ESP_OK) {
+        mv = raw * SOIL_FULL_SCALE_MV / 4095;
+    }
+    return (uint16_t)mv;
+}
+
+static void sort_samples(uint16_t *v, int n) {
+    for (int i = 1; i < n; i++) {
+        uint16_t x = v[i];
+        int j = i;
+        while (j > 0 && v[j - 1] > x) {
+            v[j] = v[j - 1];
+            j--;
+        }
+        v[j] = x;
+    }
+}
+
+static void soil_burst(void) {
+    uint16_t samples[SOIL_CHANNELS][SOIL_BURST_SAMPLES];
+    int counts[SOIL_CHANNELS];
+    uint32_t errors = 0;
+
+    portENTER_CRITICAL(&s_lock);
+    uint32_t settle_ms = s_settle_ms;
+    s_burst_on = true;
+    apply_power();
+    portEXIT_CRITICAL(&s_lock);
+    int64_t on_at = esp_timer_get_time();
+
+    // 多等一个节拍，保证至少 settle_ms
+    vTaskDelay(pdMS_TO_TICKS(settle_ms) + 1);
+
+    // 逐通道连续读取。切换通道后第一次转换还带着上一通道留在采样电容上的电荷，丢弃
+    // 读取失败的点直接丢弃，不能当作0参与中位数
+    for (int c = 0; c < SOIL_CHANNELS; c++) {
+        int raw;
+        adc_oneshot_read(s_adc, s_channels[c], &raw);
+        counts[c] = 0;
+        for (int i = 0; i < SOIL_BURST_SAMPLES; i++) {
+            if (adc_oneshot_read(s_adc, s_channels[c], &raw) != ESP_OK) {
+                errors++;
+                continue;
+            }
+            samples[c][counts[c]++] = (uint16_t)raw;
+        }
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_burst_on = false;
+    apply_power();
+    portEXIT_CRITICAL(&s_lock);
+    uint32_t on_us = (uint32_t)(esp_timer_get_time() - on_at);
+
+    // 断电之后再做统计；校准曲线单调，先取原始值的分位数再换算电压。
+    // 一个点都没读到的通道保留上一次的读数
+    soil_reading_t r;
+    for (int c = 0; c < SOIL_CHANNELS; c++) {
+        uint16_t *v = samples[c];
+        int n = counts[c];
+        if (n == 0) continue;
+        sort_samples(v, n);
+        r.millivolts[c] = raw_to_mv((v[(n - 1) / 2] + v[n / 2] + 1) / 2);
+        r.spread_mv[c] = raw_to_mv(v[n * 3 / 4]) - raw_to_mv(v[n / 4]);
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    for (int c = 0; c < SOIL_CHANNELS; c++) {
+        if (counts[c] == 0) continue;
+        s_reading.millivolts[c] = r.millivolts[c];
+        s_reading.spread_mv[c] = r.spread_mv[c];
+        s_reading.valid = true;
+    }
+    s_reading.bursts++;
+    s_reading.errors += errors;
+    s_reading.last_on_us = on_us;
+    s_reading.total_on_us += on_us;
+    s_reading.at_us = on_at;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+static void soil_task(void *arg) {
+    while (1) {
+        soil_burst();
+        portENTER_CRITICAL(&s_lock);
+        uint32_t period_s = s_period_s;
+        portEXIT_CRITICAL(&s_lock);
+        // "soil now" 提前唤醒
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(period_s * 1000));
+    }
+}
+
+void soil_init(void) {
+    adc_oneshot_unit_init_cfg_t unit_cfg = { .unit_id = ADC_UNIT_1 };
+    adc_oneshot_chan_cfg_t chan_cfg = { .atten = SOIL_ATTEN, .bitwidth = ADC_BITWIDTH_DEFAULT };
+    esp_err_t err = adc_oneshot_new_unit(&unit_cfg, &s_adc);
+    for (int c = 0; c < SOIL_CHANNELS && err == ESP_OK; c++) {
+        adc_unit_t unit;
+        err = adc_oneshot_io_to_channel(s_pins[c], &unit, &s_channels[c]);
+        if (err == ESP_OK && unit != ADC_UNIT_1) err = ESP_ERR_INVALID_ARG;
+        if (err == ESP_OK) err = adc_oneshot_config_channel(s_adc, s_channels[c], &chan_cfg);
+    }
+    if (err != ESP_OK) {
+        printf("[土壤] ADC初始化失败: %s\n", esp_err_to_name(err));
+        return;
+    }
+
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+    adc_cali_curve_fitting_config_t cali_cfg = {
+        .unit_id = ADC_UNIT_1,
+        .atten = SOIL_ATTEN,
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+    if (adc_cali_create_scheme_curve_fitting(&cali_cfg, &s_cali) != ESP_OK) s_cali = NULL;
+#endif
+
+    s_adc_ok = true;
+    xTaskCreate(soil_task, "soil", 3072, NULL, 3, &s_task);
+}
+
+void soil_get(soil_reading_t *reading) {
+    portENTER_CRITICAL(&s_lock);
+    *reading = s_reading;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void soil_manual(uint8_t state) {
+    portENTER_CRITICAL(&s_lock);
+    s_manual_on = state;
+    apply_power();
+    portEXIT_CRITICAL(&s_lock);
+    printf("[三极管控制] 传感器电源 GPIO_%d -> %s\n", GPIO_PIN_SENSOR_POWER,
+           state ? "上电 (\"sensor 0\" 恢复突发采样)" : "断电");
+
+    if (state == 1) {
+        vTaskDelay(pdMS_TO_TICKS(50)); // 50ms稳定时间
+    }
+}
+
+static void print_status(void) {
+    soil_reading_t r;
+    soil_get(&r);
+    portENTER_CRITICAL(&s_lock);
+    uint32_t period_s = s_period_s;
+    uint32_t settle_ms = s_settle_ms;
+    bool manual = s_manual_on;
+    portEXIT_CRITICAL(&s_lock);
+
+    printf("[土壤] 每 %lu s 突发采样一次，稳定 %lu ms，每通道 %d 点%s%s\n",
+           (unsigned long)period_s, (unsigned long)settle_ms, SOIL_BURST_SAMPLES,
+           s_cali ? "" : " (无ADC校准，电压为估算值)", manual ? "，电源手动常开" : "");
+    if (!r.valid) {
+        printf("[土壤] 尚无读数\n");
+        return;
+    }
+    for (int c = 0; c < SOIL_CHANNELS; c++) {
+        printf("  通道%d (GPIO_%d): %u mV  四分位距 %u mV\n",
+               c + 1, s_pins[c], r.millivolts[c], r.spread_mv[c]);
+    }
+    float uptime_s = esp_timer_get_time() / 1e6f;
+    printf("[土壤] 探头通电: 上次 %.1f ms，累计 %.1f s / 运行 %.0f s (%.3f%%)，%lu 次突发，ADC错误 %lu\n",
+           r.last_on_us / 1000.0f, r.total_on_us / 1e6f, uptime_s,
+           uptime_s > 0 ? r.total_on_us / 1e4f / uptime_s : 0.0f,
+           (unsigned long)r.bursts, (unsigned long)r.errors);
+}
+
+void soil_command(const char *args) {
+    char sub[16] = "";
+    unsigned value;
+    sscanf(args, "%15s", sub);
+
+    if (!s_adc_ok) {
+        printf("[土壤] ADC不可用\n");
+    } else if (sub[0] == '\0' || strcmp(sub, "status") == 0) {
+        print_status();
+    } else if (strcmp(sub, "now") == 0) {
+        xTaskNotifyGive(s_task);
+        printf("[土壤] 立即采样\n");
+    } else if (strcmp(sub, "period") == 0 && sscanf(args, "%*s %u", &value) == 1) {
+        if (value < 5 || value > 3600) {
+            printf("[错误] 采样周期范围 5~3600 秒\n");
+            return;
+        }
+        portENTER_CRITICAL(&s_lock);
+        s_period_s = value;
+        portEXIT_CRITICAL(&s_lock);
+        printf("[土壤] 每 %u s 采样一次 (下个周期生效)\n", value);
+    } else if (strcmp(sub, "settle") == 0 && sscanf(args, "%*s %u", &value) == 1) {
+        if (value < 1 || value > 1000) {
+            printf("[错误] 稳定时间范围 1~1000 ms\n");
+            return;
+        }
+        portENTER_CRITICAL(&s_lock);
+        s_settle_ms = value;
+        portEXIT_CRITICAL(&s_lock);
+        printf("[土壤] 上电稳定时间 %u ms\n", value);
+    } else {
+        printf("用法: soil [status|now|period <秒>|settle <毫秒>]\n");
+    }
+}
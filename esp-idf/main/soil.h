@@ -0,0 +1,38 @@
+#ifndef SOIL_H
+#define SOIL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// 土壤湿度探头 (ADC1)。探头电源经 GPIO_PIN_SENSOR_POWER 平时断开，每个周期做一次
+// 突发采样：上电、等待稳定、连续快速读完全部通道、断电，再发布一次中位数。
+// 电阻式探头通电时会电解腐蚀并持续耗电，这样每次测量只通电：稳定时间 (默认20ms)
+// 加最多一个节拍 (100Hz 时 10ms)，再加 2×17 次转换，约 30ms。每次的实际通电
+// 时长都会测出，见 last_on_us 与 "soil status"。
+
+#define SOIL_CHANNELS          2
+
+typedef struct {
+    uint16_t millivolts[SOIL_CHANNELS];   // 一次突发的中位数
+    uint16_t spread_mv[SOIL_CHANNELS];    // 同一次突发的四分位距，反映噪声
+    bool valid;                           // 至少完成过一次读到数据的突发
+    uint32_t bursts;                      // 累计突发次数
+    uint32_t errors;                      // ADC读取失败次数
+    uint32_t last_on_us;                  // 上次探头通电时长
+    uint64_t total_on_us;                 // 累计通电时长
+    int64_t at_us;                        // 上次采样时刻 (esp_timer)
+} soil_reading_t;
+
+// 配置ADC通道并启动采样任务
+void soil_init(void);
+
+// 复制最近一次读数
+void soil_get(soil_reading_t *reading);
+
+// "sensor 0/1"：手动开关探头电源，开启后突发采样结束时不再断电
+void soil_manual(uint8_t state);
+
+// 串口命令 "soil ..." 的参数部分
+void soil_command(const char *args);
+
+#endif
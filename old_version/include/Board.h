@@ -0,0 +1,120 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <Arduino.h>
+#include <driver/gpio.h>
+#include <soc/gpio_struct.h>
+
+// Compile-time board description. Every output is a type carrying its pin,
+// active level and driver, so switching it compiles to a single store to
+// the GPIO set/clear register: no pin lookup, no range checks and no
+// digitalWrite() call in the pump path. Lists of outputs and inputs
+// produce their init masks and dispatch tables at compile time.
+
+typedef void (*ActuatorWrite)(bool on);
+
+// Writes the ESP32 output registers directly. GPIO0..31 live in the first
+// bank, 32..39 in the second.
+struct DirectDrive {
+  template <uint8_t Pin>
+  static inline void write(bool high) {
+    if (Pin < 32) {
+      if (high) GPIO.out_w1ts = 1UL << (Pin & 31);
+      else      GPIO.out_w1tc = 1UL << (Pin & 31);
+    } else {
+      if (high) GPIO.out1_w1ts.val = 1UL << (Pin & 31);
+      else      GPIO.out1_w1tc.val = 1UL << (Pin & 31);
+    }
+  }
+};
+
+// For outputs that must go through the Arduino layer (e.g. pins a
+// library also drives).
+struct ArduinoDrive {
+  template <uint8_t Pin>
+  static inline void write(bool high) { digitalWrite(Pin, high ? HIGH : LOW); }
+};
+
+template <uint8_t Pin, uint8_t ActiveLevel = HIGH, class Driver = DirectDrive>
+struct Actuator {
+  static_assert(Pin < 34, "GPIO34..39 are input-only");
+  static_assert(Pin < 6 || Pin > 11, "GPIO6..11 belong to the SPI flash");
+
+  static const uint8_t pin = Pin;
+  static const uint64_t mask = 1ULL << Pin;
+  static const uint64_t activeLowMask = ActiveLevel == LOW ? mask : 0;
+
+  static inline void write(bool on) { Driver::template write<Pin>(on == (ActiveLevel == HIGH)); }
+  static inline void on() { write(true); }
+  static inline void off() { write(false); }
+};
+
+// Ordered list of actuators; an actuator's index is its position.
+template <class... As>
+struct ActuatorList;
+
+template <>
+struct ActuatorList<> {
+  static const uint8_t count = 0;
+  static const uint64_t mask = 0;
+  static const uint64_t activeLowMask = 0;
+  static void allOff() {}
+};
+
+template <class A, class... Rest>
+struct ActuatorList<A, Rest...> {
+  static const uint8_t count = 1 + sizeof...(Rest);
+  static const uint64_t mask = A::mask | ActuatorList<Rest...>::mask;
+  static const uint64_t activeLowMask = A::activeLowMask | ActuatorList<Rest...>::activeLowMask;
+  static_assert((A::mask & ActuatorList<Rest...>::mask) == 0, "pin used by two actuators");
+
+  static void allOff() {
+    A::off();
+    ActuatorList<Rest...>::allOff();
+  }
+
+  // Drives every output to its off level, then enables them all in one
+  // gpio_config() call, so no output glitches on at boot.
+  static void begin() {
+    allOff();
+    gpio_config_t io = {};
+    io.pin_bit_mask = mask;
+    io.mode = GPIO_MODE_OUTPUT;
+    io.pull_up_en = GPIO_PULLUP_DISABLE;
+    io.pull_down_en = GPIO_PULLDOWN_DISABLE;
+    io.intr_type = GPIO_INTR_DISABLE;
+    gpio_config(&io);
+    allOff();
+  }
+
+  // Switch function of actuator i, for runtime dispatch (e.g. by zone).
+  static ActuatorWrite writer(uint8_t i) {
+    static const ActuatorWrite table[count] = {A::write, Rest::write...};
+    return i < count ? table[i] : nullptr;
+  }
+};
+
+// Input pins (sensors, buttons); pins[] is the list in declaration order.
+template <uint8_t... Pins>
+struct PinList;
+
+template <>
+struct PinList<> {
+  static const uint64_t mask = 0;
+};
+
+template <uint8_t P, uint8_t... Rest>
+struct PinList<P, Rest...> {
+  static const uint8_t count = 1 + sizeof...(Rest);
+  static const uint64_t mask = (1ULL << P) | PinList<Rest...>::mask;
+  static_assert(((1ULL << P) & PinList<Rest...>::mask) == 0, "pin listed twice");
+  static const uint8_t pins[count];
+};
+
+template <uint8_t P, uint8_t... Rest>
+const uint8_t PinList<P, Rest...>::pins[] = {P, Rest...};
+
+// ADC2 is unavailable while Wi-Fi runs; analog sensors belong on ADC1.
+constexpr bool isAdc1Pin(uint8_t pin) { return pin >= 32 && pin <= 39; }
+
+#endif
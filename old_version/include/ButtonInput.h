@@ -0,0 +1,190 @@
+#ifndef BUTTON_INPUT_H
+#define BUTTON_INPUT_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/timers.h>
+#include <driver/gpio.h>
+#include <esp_sleep.h>
+#include "SpscRing.h"
+
+#define BUTTON_MAX         8
+#define BUTTON_QUEUE_SIZE  16    // power of two
+#define BUTTON_SCAN_MS     5
+
+#define BUTTON_DEBOUNCE_MS     20
+#define BUTTON_LONG_PRESS_MS   600
+#define BUTTON_REPEAT_MS       150
+#define BUTTON_DOUBLE_CLICK_MS 300
+
+enum ButtonGesture : uint8_t {
+  BUTTON_PRESS,          // debounced press, always sent first
+  BUTTON_RELEASE,
+  BUTTON_CLICK,          // press and release, no second press in time
+  BUTTON_DOUBLE_CLICK,   // second press within BUTTON_DOUBLE_CLICK_MS
+  BUTTON_LONG_PRESS,     // held for BUTTON_LONG_PRESS_MS
+  BUTTON_REPEAT          // every BUTTON_REPEAT_MS while held after a long press
+};
+
+struct ButtonEvent {
+  uint8_t button;        // index passed to add()
+  ButtonGesture gesture;
+  uint32_t at;           // millis()
+};
+
+// Active-low buttons read through GPIO edge interrupts. An edge starts a
+// FreeRTOS timer that samples the pins every BUTTON_SCAN_MS for debounce
+// and gesture timing, then stops itself once every button is idle, so
+// nothing runs between presses. Gestures go through a lock-free
+// single-producer/single-consumer queue (timer task in, loop() out).
+class ButtonInput {
+private:
+  struct State {
+    uint8_t pin;
+    bool pressed;         // debounced
+    uint8_t stableMs;     // time the raw level has disagreed with pressed
+    bool longSent;
+    bool clickPending;    // released once, waiting for a second press
+    bool doublePress;     // current press is the second of a double click
+    uint32_t pressedAt;
+    uint32_t releasedAt;
+    uint32_t nextRepeat;
+  };
+
+  State buttons[BUTTON_MAX];
+  uint8_t count;
+
+  SpscRing<ButtonEvent, BUTTON_QUEUE_SIZE> queue;
+
+  TimerHandle_t timer;
+  volatile bool scanning;
+
+  void post(uint8_t b, ButtonGesture g, uint32_t now) {
+    queue.push({b, g, now});
+  }
+
+  // One debounce/gesture step; returns true while the button needs more scans.
+  bool scan(uint8_t b, uint32_t now) {
+    State &s = buttons[b];
+    bool raw = digitalRead(s.pin) == LOW;
+
+    if (raw != s.pressed) {
+      s.stableMs += BUTTON_SCAN_MS;
+      if (s.stableMs >= BUTTON_DEBOUNCE_MS) {
+        s.stableMs = 0;
+        s.pressed = raw;
+        if (raw) {
+          post(b, BUTTON_PRESS, now);
+          s.pressedAt = now;
+          s.longSent = false;
+          s.doublePress = s.clickPending && now - s.releasedAt <= BUTTON_DOUBLE_CLICK_MS;
+          s.clickPending = false;
+          if (s.doublePress) post(b, BUTTON_DOUBLE_CLICK, now);
+        } else {
+          post(b, BUTTON_RELEASE, now);
+          s.releasedAt = now;
+          s.clickPending = !s.longSent && !s.doublePress;
+        }
+      }
+    } else {
+      s.stableMs = 0;
+    }
+
+    if (s.pressed) {
+      if (!s.longSent && now - s.pressedAt >= BUTTON_LONG_PRESS_MS) {
+        post(b, BUTTON_LONG_PRESS, now);
+        s.longSent = true;
+        s.nextRepeat = now + BUTTON_REPEAT_MS;
+      } else if (s.longSent && (int32_t)(now - s.nextRepeat) >= 0) {
+        post(b, BUTTON_REPEAT, now);
+        s.nextRepeat += BUTTON_REPEAT_MS;
+      }
+    } else if (s.clickPending && now - s.releasedAt > BUTTON_DOUBLE_CLICK_MS) {
+      post(b, BUTTON_CLICK, now);
+      s.clickPending = false;
+    }
+
+    return s.pressed || s.clickPending || s.stableMs > 0;
+  }
+
+  static void onTimer(TimerHandle_t t) {
+    ButtonInput *self = (ButtonInput *)pvTimerGetTimerID(t);
+    uint32_t now = millis();
+    bool busy = false;
+    for (uint8_t b = 0; b < self->count; b++) busy |= self->scan(b, now);
+    if (busy) return;
+
+    xTimerStop(t, 0);
+    self->scanning = false;
+    // An edge between the last scan and clearing the flag found the timer
+    // still marked as running; pick it up here instead of losing it.
+    for (uint8_t b = 0; b < self->count; b++) {
+      if ((digitalRead(self->buttons[b].pin) == LOW) != self->buttons[b].pressed) {
+        self->scanning = true;
+        xTimerStart(t, 0);
+        break;
+      }
+    }
+  }
+
+  static void IRAM_ATTR onEdge(void *arg) {
+    ButtonInput *self = (ButtonInput *)arg;
+    if (self->scanning) return;
+    self->scanning = true;
+    BaseType_t woken = pdFALSE;
+    xTimerStartFromISR(self->timer, &woken);
+    if (woken) portYIELD_FROM_ISR();
+  }
+
+public:
+  ButtonInput() : count(0), timer(nullptr), scanning(false) {}
+
+  // Registers an active-low button; returns its index, or 0xFF when full.
+  uint8_t add(uint8_t pin) {
+    if (count >= BUTTON_MAX) return 0xFF;
+    State &s = buttons[count];
+    memset(&s, 0, sizeof(s));
+    s.pin = pin;
+    pinMode(pin, INPUT_PULLUP);
+    return count++;
+  }
+
+  bool begin() {
+    timer = xTimerCreate("buttons", pdMS_TO_TICKS(BUTTON_SCAN_MS), pdTRUE, this, onTimer);
+    if (!timer) return false;
+    for (uint8_t b = 0; b < count; b++) {
+      attachInterruptArg(digitalPinToInterrupt(buttons[b].pin), onEdge, this, CHANGE);
+    }
+    return true;
+  }
+
+  // Pops the oldest gesture; false when the queue is empty.
+  bool poll(ButtonEvent &e) { return queue.pop(e); }
+
+  // Light-sleeps for up to maxMs, waking early on any button press. GPIO
+  // wakeup is level-triggered and replaces the pin's edge interrupt, so the
+  // edges are restored afterwards.
+  void lightSleep(uint32_t maxMs) {
+    if (scanning) return;
+    for (uint8_t b = 0; b < count; b++) {
+      gpio_wakeup_enable((gpio_num_t)buttons[b].pin, GPIO_INTR_LOW_LEVEL);
+    }
+    esp_sleep_enable_gpio_wakeup();
+    esp_sleep_enable_timer_wakeup((uint64_t)maxMs * 1000ULL);
+    esp_light_sleep_start();
+    for (uint8_t b = 0; b < count; b++) {
+      gpio_wakeup_disable((gpio_num_t)buttons[b].pin);
+      gpio_set_intr_type((gpio_num_t)buttons[b].pin, GPIO_INTR_ANYEDGE);
+    }
+    // The level that woke us is not an edge; start a scan for it.
+    if (!scanning) {
+      scanning = true;
+      xTimerStart(timer, 0);
+    }
+  }
+
+  bool isScanning() const { return scanning; }
+  uint32_t getDropped() const { return queue.getDropped(); }
+};
+
+#endif
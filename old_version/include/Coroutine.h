@@ -0,0 +1,171 @@
+#ifndef COROUTINE_H
+#define COROUTINE_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Stackless coroutines for hardware sequences that mostly wait.
+//
+// A sequence subclasses Coroutine and writes its steps linearly in step()
+// between CO_BEGIN() and CO_END(); every wait macro returns to the
+// scheduler and resumes on the following line later. Nothing lives on a
+// stack across a wait, so values that must survive one are members: the
+// object itself is the frame, sized at compile time, no heap. The
+// toolchain (GCC 8) predates C++20 coroutines; this is the protothread
+// form of the same idea. Don't put a wait inside a switch of your own.
+
+enum CoWait : uint8_t {
+  CO_WAIT_NONE,     // run every tick (also used by CO_WAIT_UNTIL)
+  CO_WAIT_SLEEP,
+  CO_WAIT_PIN,
+  CO_WAIT_EVENT
+};
+
+class Coroutine {
+public:
+  uint16_t resumeLine = 0;   // 0 = start from the top
+  CoWait wait = CO_WAIT_NONE;
+  uint8_t pin = 0;
+  uint8_t level = 0;
+  bool timedOut = false;     // the last wait ended on its deadline
+  bool hasDeadline = false;
+  bool scheduled = false;
+  uint32_t events = 0;       // waited for; after the wait, the ones received
+  uint32_t wakeAt = 0;       // millis() deadline
+
+  virtual ~Coroutine() {}
+
+  // One resumption; returns false once the sequence has finished.
+  virtual bool step() = 0;
+
+  void restart() {
+    resumeLine = 0;
+    wait = CO_WAIT_NONE;
+    timedOut = false;
+  }
+};
+
+#define CO_BEGIN() switch (resumeLine) { case 0:
+#define CO_END() } resumeLine = 0; return false
+
+#define CO_SUSPEND()                              \
+  do {                                            \
+    resumeLine = __LINE__; return true;           \
+    case __LINE__:;                               \
+  } while (0)
+
+// Gives the other sequences a turn; resumes next tick.
+#define CO_YIELD() do { wait = CO_WAIT_NONE; CO_SUSPEND(); } while (0)
+
+// Re-checks cond every tick until it holds.
+#define CO_WAIT_UNTIL(cond)                       \
+  do {                                            \
+    wait = CO_WAIT_NONE;                          \
+    resumeLine = __LINE__;                        \
+    case __LINE__:                                \
+    if (!(cond)) return true;                     \
+  } while (0)
+
+#define CO_SLEEP_FOR(ms)                          \
+  do {                                            \
+    wait = CO_WAIT_SLEEP;                         \
+    hasDeadline = true;                           \
+    wakeAt = millis() + (uint32_t)(ms);           \
+    CO_SUSPEND();                                 \
+  } while (0)
+
+// Until digitalRead(p) == lvl, or timeoutMs (0 = forever); see timedOut.
+#define CO_WAIT_PIN(p, lvl, timeoutMs)            \
+  do {                                            \
+    wait = CO_WAIT_PIN;                           \
+    pin = (p);                                    \
+    level = (lvl);                                \
+    hasDeadline = (timeoutMs) != 0;               \
+    wakeAt = millis() + (uint32_t)(timeoutMs);    \
+    CO_SUSPEND();                                 \
+  } while (0)
+
+// Until any bit of mask is signalled, or timeoutMs (0 = forever). The
+// bits received are left in events.
+#define CO_WAIT_EVENT(mask, timeoutMs)            \
+  do {                                            \
+    wait = CO_WAIT_EVENT;                         \
+    events = (mask);                              \
+    hasDeadline = (timeoutMs) != 0;               \
+    wakeAt = millis() + (uint32_t)(timeoutMs);    \
+    CO_SUSPEND();                                 \
+  } while (0)
+
+// Runs up to N coroutines from the control loop. Each tick resumes every
+// sequence whose wait is over; a waiting sequence costs one compare.
+// Events are bits: signal() may be called from any task or ISR and wakes
+// the sequences waiting on them at the next tick; bits nobody waits for
+// are dropped.
+template <uint16_t N>
+class CoScheduler {
+private:
+  Coroutine *tasks[N];
+  uint16_t count;
+  std::atomic<uint32_t> pending;
+
+  static bool ready(Coroutine &c, uint32_t now, uint32_t ev) {
+    bool expired = c.hasDeadline && (int32_t)(now - c.wakeAt) >= 0;
+    bool met;
+    switch (c.wait) {
+      case CO_WAIT_SLEEP: met = false; break;
+      case CO_WAIT_PIN:   met = digitalRead(c.pin) == c.level; break;
+      case CO_WAIT_EVENT: met = (c.events & ev) != 0; break;
+      default:            return true;
+    }
+    if (!met && !expired) return false;
+    if (c.wait == CO_WAIT_EVENT) c.events &= ev;
+    c.timedOut = !met && c.wait != CO_WAIT_SLEEP;
+    c.wait = CO_WAIT_NONE;
+    c.hasDeadline = false;
+    return true;
+  }
+
+public:
+  CoScheduler() : count(0), pending(0) {}
+
+  // Starts c from the top; false when full. Starting a running sequence
+  // restarts it.
+  bool start(Coroutine &c) {
+    c.restart();
+    if (c.scheduled) return true;
+    if (count >= N) return false;
+    c.scheduled = true;
+    tasks[count++] = &c;
+    return true;
+  }
+
+  void stop(Coroutine &c) {
+    for (uint16_t i = 0; i < count; i++) {
+      if (tasks[i] == &c) {
+        tasks[i] = tasks[--count];
+        c.scheduled = false;
+        return;
+      }
+    }
+  }
+
+  void signal(uint32_t bits) { pending.fetch_or(bits, std::memory_order_release); }
+
+  void update() {
+    uint32_t now = millis();
+    uint32_t ev = pending.exchange(0, std::memory_order_acquire);
+    for (uint16_t i = 0; i < count;) {
+      Coroutine &c = *tasks[i];
+      if (ready(c, now, ev) && !c.step()) {
+        tasks[i] = tasks[--count];
+        c.scheduled = false;
+        continue;
+      }
+      i++;
+    }
+  }
+
+  uint16_t getCount() const { return count; }
+};
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef DRYING_ESTIMATOR_H
+#define DRYING_ESTIMATOR_H
+
+#include <Arduino.h>
+#include "ZoneTable.h"
+
+#define DRY_MIN_DT_MS     (10UL * 60UL * 1000UL)  // shortest slope baseline
+#define DRY_LEARN_MS      (2UL * 60UL * 1000UL)   // check cadence while learning
+#define DRY_MIN_CHECK_MS  (5UL * 60UL * 1000UL)
+#define DRY_MAX_CHECK_MS  (2UL * 3600UL * 1000UL)
+#define DRY_DOSE_CHECK_MS 5000UL                   // adaptive dosing needs fresh data
+#define DRY_MIN_UPDATES   3
+#define DRY_FORGET        0.97f
+
+// Learns each zone's drying rate (%/h) online with recursive least squares
+// on rate = t0 + t1*(T - 25) + t2*(RH - 50)/10, then schedules the zone's
+// next sensor check shortly before the threshold is predicted to be
+// crossed. Watering resets the slope baseline so refills are not learned.
+class DryingEstimator {
+private:
+  static const uint8_t NP = 3;
+
+  ZoneState &zones;
+
+  float theta[MAX_ZONES][NP];
+  float P[MAX_ZONES][NP][NP];
+  uint8_t updates[MAX_ZONES];
+
+  int16_t anchorMoisture[MAX_ZONES];
+  uint32_t anchorTime[MAX_ZONES];
+  uint32_t lastSeen[MAX_ZONES];
+  uint16_t anchored;
+
+  float temperature;
+  float humidity;
+
+  void regressors(float *phi) const {
+    phi[0] = 1.0f;
+    phi[1] = isnan(temperature) ? 0.0f : temperature - 25.0f;
+    phi[2] = isnan(humidity) ? 0.0f : (humidity - 50.0f) * 0.1f;
+  }
+
+  void resetModel(uint8_t z) {
+    memset(theta[z], 0, sizeof(theta[z]));
+    memset(P[z], 0, sizeof(P[z]));
+    for (uint8_t i = 0; i < NP; i++) P[z][i][i] = 100.0f;
+    updates[z] = 0;
+  }
+
+  void learn(uint8_t z, float y) {
+    float phi[NP];
+    regressors(phi);
+
+    float Pphi[NP];
+    float denom = DRY_FORGET;
+    for (uint8_t i = 0; i < NP; i++) {
+      Pphi[i] = 0;
+      for (uint8_t j = 0; j < NP; j++) Pphi[i] += P[z][i][j] * phi[j];
+      denom += phi[i] * Pphi[i];
+    }
+
+    float err = y;
+    for (uint8_t i = 0; i < NP; i++) err -= theta[z][i] * phi[i];
+
+    for (uint8_t i = 0; i < NP; i++) {
+      float k = Pphi[i] / denom;
+      theta[z][i] += k * err;
+      for (uint8_t j = 0; j < NP; j++) {
+        P[z][i][j] = (P[z][i][j] - k * Pphi[j]) / DRY_FORGET;
+      }
+    }
+
+    // Keep the covariance bounded when the input stops exciting it.
+    float trace = P[z][0][0] + P[z][1][1] + P[z][2][2];
+    if (trace > 1e4f) {
+      for (uint8_t i = 0; i < NP; i++)
+        for (uint8_t j = 0; j < NP; j++) P[z][i][j] *= 1e4f / trace;
+    }
+    if (updates[z] < 255) updates[z]++;
+  }
+
+  uint32_t nextCheckDelay(uint8_t z) const {
+    if (zones.dosing & ZoneState::bit(z)) return DRY_DOSE_CHECK_MS;
+    if (updates[z] < DRY_MIN_UPDATES) return DRY_LEARN_MS;
+
+    float rate = predictedRate(z);
+    float margin = (zones.moisture[z] - zones.threshold[z]) * 0.1f;
+    if (margin <= 0) return DRY_MIN_CHECK_MS;
+    if (rate > -0.01f) return DRY_MAX_CHECK_MS;
+
+    // Wake at 80 % of the predicted time so the crossing is not missed.
+    float ms = margin / -rate * 3600000.0f * 0.8f;
+    if (ms < DRY_MIN_CHECK_MS) return DRY_MIN_CHECK_MS;
+    if (ms > DRY_MAX_CHECK_MS) return DRY_MAX_CHECK_MS;
+    return (uint32_t)ms;
+  }
+
+public:
+  DryingEstimator(ZoneState &z) : zones(z), anchored(0),
+                                  temperature(NAN), humidity(NAN) {
+    for (uint8_t i = 0; i < MAX_ZONES; i++) resetModel(i);
+    memset(lastSeen, 0, sizeof(lastSeen));
+  }
+
+  void setClimate(float t, float h) {
+    temperature = t;
+    humidity = h;
+  }
+
+  // Consumes readings published since the last call and reschedules
+  // each zone's next check.
+  void update() {
+    uint32_t now = millis();
+    for (uint8_t z = 0; z < zones.count; z++) {
+      uint16_t bit = ZoneState::bit(z);
+      if (!(zones.valid & bit) || zones.isSuspect(z) || zones.readingAt[z] == lastSeen[z]) {
+        // Zones being dosed must not wait for the model.
+        if ((zones.dosing & bit) &&
+            (int32_t)(zones.nextCheck[z] - now) > (int32_t)DRY_DOSE_CHECK_MS) {
+          zones.nextCheck[z] = now + DRY_DOSE_CHECK_MS;
+        }
+        continue;
+      }
+      lastSeen[z] = zones.readingAt[z];
+
+      bool refilled = (zones.watered & bit) &&
+                      (int32_t)(zones.pumpStart[z] - anchorTime[z]) > 0;
+      if (!(anchored & bit) || refilled || (zones.dosing & bit)) {
+        anchorMoisture[z] = zones.moisture[z];
+        anchorTime[z] = zones.readingAt[z];
+        anchored |= bit;
+      } else if (zones.readingAt[z] - anchorTime[z] >= DRY_MIN_DT_MS) {
+        float hours = (zones.readingAt[z] - anchorTime[z]) / 3600000.0f;
+        learn(z, (zones.moisture[z] - anchorMoisture[z]) * 0.1f / hours);
+        anchorMoisture[z] = zones.moisture[z];
+        anchorTime[z] = zones.readingAt[z];
+      }
+
+      zones.nextCheck[z] = now + nextCheckDelay(z);
+    }
+  }
+
+  // Drying rate in %/h under the current climate (negative = drying).
+  float predictedRate(uint8_t z) const {
+    float phi[NP];
+    regressors(phi);
+    float r = 0;
+    for (uint8_t i = 0; i < NP; i++) r += theta[z][i] * phi[i];
+    return r;
+  }
+
+  // Hours until the threshold is reached, NAN when unknown or not drying.
+  float hoursToThreshold(uint8_t z) const {
+    if (updates[z] < DRY_MIN_UPDATES || !zones.isValid(z)) return NAN;
+    float rate = predictedRate(z);
+    if (rate > -0.01f) return NAN;
+    float margin = (zones.moisture[z] - zones.threshold[z]) * 0.1f;
+    return margin > 0 ? margin / -rate : 0.0f;
+  }
+
+  uint8_t getUpdates(uint8_t z) const { return updates[z]; }
+};
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef HISTORY_ROLLUP_H
+#define HISTORY_ROLLUP_H
+
+#include <Arduino.h>
+
+#define ROLLUP_MINUTES 60    // 1 h of 1-minute buckets
+#define ROLLUP_HOURS   48    // 2 days of 1-hour buckets
+#define ROLLUP_DAYS    120   // 4 months of 1-day buckets
+
+enum RollupAgg {
+  ROLLUP_MIN,
+  ROLLUP_MAX,
+  ROLLUP_AVG,
+  ROLLUP_COUNT
+};
+
+// Multi-resolution min/max/sum/count rollups, updated in O(1) per sample
+// (one bucket per tier). Every bucket is tagged with its absolute slot
+// number, so stale ring entries are recognised without sweeping. A
+// range query walks the range greedily with the coarsest bucket that is
+// aligned and fits, so months cost a couple of hundred bucket reads at
+// most. Edges older than the finer rings fall back to the enclosing
+// coarser bucket and mark the result approximate.
+// Times are seconds (RTCManager::getEpoch()).
+template <uint8_t NSERIES>
+class HistoryRollup {
+public:
+  struct Result {
+    int32_t min;
+    int32_t max;
+    int64_t sum;
+    uint32_t count;
+    bool approximate;   // an edge fell back to a coarser bucket
+
+    float value(RollupAgg agg) const {
+      if (count == 0) return NAN;
+      switch (agg) {
+        case ROLLUP_MIN:   return min;
+        case ROLLUP_MAX:   return max;
+        case ROLLUP_AVG:   return (float)sum / count;
+        case ROLLUP_COUNT: return count;
+      }
+      return NAN;
+    }
+  };
+
+private:
+  struct Bucket {
+    uint32_t slot;
+    int16_t min;
+    int16_t max;
+    int32_t sum;
+    uint16_t count;
+  };
+
+  static const uint8_t TIERS = 3;
+
+  Bucket minutes[NSERIES][ROLLUP_MINUTES];
+  Bucket hours[NSERIES][ROLLUP_HOURS];
+  Bucket days[NSERIES][ROLLUP_DAYS];
+  uint32_t newest;
+
+  static uint32_t period(uint8_t tier) {
+    static const uint32_t p[TIERS] = {60UL, 3600UL, 86400UL};
+    return p[tier];
+  }
+
+  Bucket *bucket(uint8_t series, uint8_t tier, uint32_t slot) {
+    switch (tier) {
+      case 0:  return &minutes[series][slot % ROLLUP_MINUTES];
+      case 1:  return &hours[series][slot % ROLLUP_HOURS];
+      default: return &days[series][slot % ROLLUP_DAYS];
+    }
+  }
+
+  const Bucket *find(uint8_t series, uint8_t tier, uint32_t slot) const {
+    const Bucket *b = const_cast<HistoryRollup *>(this)->bucket(series, tier, slot);
+    return (b->count > 0 && b->slot == slot) ? b : nullptr;
+  }
+
+  bool retained(uint8_t tier, uint32_t slot) const {
+    static const uint16_t size[TIERS] = {ROLLUP_MINUTES, ROLLUP_HOURS, ROLLUP_DAYS};
+    return slot + size[tier] > newest / period(tier);
+  }
+
+  static void merge(Result &r, const Bucket &b) {
+    if (r.count == 0 || b.min < r.min) r.min = b.min;
+    if (r.count == 0 || b.max > r.max) r.max = b.max;
+    r.sum += b.sum;
+    r.count += b.count;
+  }
+
+public:
+  HistoryRollup() : newest(0) {
+    memset(minutes, 0, sizeof(minutes));
+    memset(hours, 0, sizeof(hours));
+    memset(days, 0, sizeof(days));
+  }
+
+  void add(uint8_t series, uint32_t t, int16_t value) {
+    if (series >= NSERIES) return;
+    for (uint8_t tier = 0; tier < TIERS; tier++) {
+      uint32_t slot = t / period(tier);
+      Bucket *b = bucket(series, tier, slot);
+      if (b->slot != slot || b->count == 0) {
+        b->slot = slot;
+        b->min = b->max = value;
+        b->sum = value;
+        b->count = 1;
+      } else {
+        if (value < b->min) b->min = value;
+        if (value > b->max) b->max = value;
+        b->sum += value;
+        if (b->count < UINT16_MAX) b->count++;
+      }
+    }
+    if (t > newest) newest = t;
+  }
+
+  Result query(uint8_t series, uint32_t from, uint32_t to) const {
+    Result r = {0, 0, 0, 0, false};
+    if (series >= NSERIES || from > to) return r;
+
+    // Nothing older than the day ring can be answered.
+    uint32_t firstDay = newest / 86400UL;
+    firstDay = firstDay >= ROLLUP_DAYS ? firstDay - (ROLLUP_DAYS - 1) : 0;
+    if (from < firstDay * 86400UL) from = firstDay * 86400UL;
+    if (to > newest) to = newest;
+    if (from > to) return r;
+    from -= from % 60;
+    to += 59 - to % 60;
+
+    uint32_t t = from;
+    while (t <= to) {
+      bool advanced = false;
+
+      // Coarsest bucket that starts at t, ends inside the range and has
+      // not rotated out. A missing bucket there means no samples.
+      for (int8_t tier = TIERS - 1; tier >= 0 && !advanced; tier--) {
+        uint32_t p = period(tier);
+        if (t % p != 0 || (uint64_t)t + p - 1 > to || !retained(tier, t / p)) continue;
+        const Bucket *b = find(series, tier, t / p);
+        if (b) merge(r, *b);
+        t += p;
+        advanced = true;
+      }
+
+      // The fine tiers no longer hold t: take the finest surviving bucket
+      // containing it, which may reach outside the range.
+      for (uint8_t tier = 0; tier < TIERS && !advanced; tier++) {
+        uint32_t p = period(tier);
+        if (!retained(tier, t / p)) continue;
+        const Bucket *b = find(series, tier, t / p);
+        if (b) {
+          merge(r, *b);
+          r.approximate = true;
+        }
+        t = (t / p + 1) * p;
+        advanced = true;
+      }
+
+      if (!advanced) break;
+    }
+    return r;
+  }
+
+  uint32_t getNewest() const { return newest; }
+};
+
+#endif
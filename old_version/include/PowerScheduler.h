@@ -0,0 +1,175 @@
+#ifndef POWER_SCHEDULER_H
+#define POWER_SCHEDULER_H
+
+#include <Arduino.h>
+#include "Board.h"
+
+#define POWER_MAX_ACTUATORS 16
+#define POWER_MAX_JOBS      POWER_MAX_ACTUATORS
+
+// Starts actuators from a priority queue without exceeding a supply
+// current budget. Each actuator declares its draw; consecutive starts are
+// spaced so inrush currents never overlap. Lower priority values run
+// first (callers pass moisture, so the driest zone goes first).
+class PowerScheduler {
+private:
+  struct Job {
+    int16_t priority;
+    uint8_t actuator;
+    uint32_t durationMs;
+  };
+
+  uint8_t actuatorCount;
+  ActuatorWrite write[POWER_MAX_ACTUATORS];
+  uint16_t drawMa[POWER_MAX_ACTUATORS];
+  uint32_t runStart[POWER_MAX_ACTUATORS];
+  uint32_t runDuration[POWER_MAX_ACTUATORS];
+  uint32_t runStartUs[POWER_MAX_ACTUATORS];
+  uint16_t running;
+  uint16_t queued;
+
+  Job heap[POWER_MAX_JOBS];
+  uint8_t heapSize;
+
+  uint16_t budgetMa;
+  uint16_t usedMa;
+  uint16_t spacingMs;
+  uint32_t lastStart;
+  bool started;
+
+  // How late timed runs are switched off, measured against micros().
+  uint32_t lastOffLatencyUs;
+  uint32_t worstOffLatencyUs;
+
+  static bool before(const Job &a, const Job &b) {
+    return a.priority < b.priority;
+  }
+
+  void siftUp(uint8_t i) {
+    while (i > 0) {
+      uint8_t parent = (i - 1) >> 1;
+      if (!before(heap[i], heap[parent])) break;
+      Job t = heap[i]; heap[i] = heap[parent]; heap[parent] = t;
+      i = parent;
+    }
+  }
+
+  void siftDown(uint8_t i) {
+    for (;;) {
+      uint8_t l = 2 * i + 1, r = l + 1, m = i;
+      if (l < heapSize && before(heap[l], heap[m])) m = l;
+      if (r < heapSize && before(heap[r], heap[m])) m = r;
+      if (m == i) break;
+      Job t = heap[i]; heap[i] = heap[m]; heap[m] = t;
+      i = m;
+    }
+  }
+
+  void removeAt(uint8_t i) {
+    heap[i] = heap[--heapSize];
+    if (i < heapSize) {
+      siftDown(i);
+      siftUp(i);
+    }
+  }
+
+  void switchOn(uint8_t a, uint32_t durationMs, uint32_t now) {
+    running |= bit(a);
+    usedMa += drawMa[a];
+    runStart[a] = now;
+    runDuration[a] = durationMs;
+    runStartUs[a] = micros();
+    lastStart = now;
+    started = true;
+    write[a](true);
+  }
+
+  void switchOff(uint8_t a) {
+    running &= ~bit(a);
+    usedMa -= drawMa[a];
+    write[a](false);
+  }
+
+  static uint16_t bit(uint8_t a) { return (uint16_t)1u << a; }
+
+public:
+  PowerScheduler(uint16_t budget, uint16_t spacing)
+    : actuatorCount(0), running(0), queued(0), heapSize(0),
+      budgetMa(budget), usedMa(0), spacingMs(spacing),
+      lastStart(0), started(false), lastOffLatencyUs(0), worstOffLatencyUs(0) {}
+
+  // Declares an actuator by its switch function (see Board.h; the board
+  // has already set it up as an output); returns its id, or 0xFF when full.
+  uint8_t addActuator(ActuatorWrite w, uint16_t currentMa) {
+    if (!w || actuatorCount >= POWER_MAX_ACTUATORS) return 0xFF;
+    uint8_t a = actuatorCount++;
+    write[a] = w;
+    drawMa[a] = currentMa;
+    w(false);
+    return a;
+  }
+
+  // Queues a run; a request for an actuator that is already queued or
+  // running is refused.
+  bool request(uint8_t a, int16_t priority, uint32_t durationMs) {
+    if (a >= actuatorCount || ((running | queued) & bit(a))) return false;
+    if (heapSize >= POWER_MAX_JOBS) return false;
+    heap[heapSize] = {priority, a, durationMs};
+    siftUp(heapSize++);
+    queued |= bit(a);
+    return true;
+  }
+
+  // Drops a queued job or stops a running one.
+  void cancel(uint8_t a) {
+    if (running & bit(a)) switchOff(a);
+    if (queued & bit(a)) {
+      for (uint8_t i = 0; i < heapSize; i++) {
+        if (heap[i].actuator == a) { removeAt(i); break; }
+      }
+      queued &= ~bit(a);
+    }
+  }
+
+  void update() {
+    uint32_t now = millis();
+
+    for (uint8_t a = 0; a < actuatorCount; a++) {
+      if ((running & bit(a)) && now - runStart[a] >= runDuration[a]) {
+        int32_t late = (int32_t)(micros() - runStartUs[a] - runDuration[a] * 1000UL);
+        lastOffLatencyUs = late > 0 ? late : 0;
+        if (lastOffLatencyUs > worstOffLatencyUs) worstOffLatencyUs = lastOffLatencyUs;
+        switchOff(a);
+      }
+    }
+
+    // Strict priority: the head waits for budget instead of being
+    // overtaken. A job larger than the whole budget runs on its own.
+    while (heapSize > 0) {
+      if (started && now - lastStart < spacingMs) break;
+      const Job &head = heap[0];
+      uint16_t draw = drawMa[head.actuator];
+      bool fits = usedMa + draw <= budgetMa || (running == 0 && draw > budgetMa);
+      if (!fits) break;
+
+      uint8_t a = head.actuator;
+      uint32_t duration = head.durationMs;
+      removeAt(0);
+      queued &= ~bit(a);
+      switchOn(a, duration, now);
+    }
+  }
+
+  bool isRunning(uint8_t a) const { return running & bit(a); }
+  bool isQueued(uint8_t a) const { return queued & bit(a); }
+  uint16_t getUsedMa() const { return usedMa; }
+  uint16_t getBudgetMa() const { return budgetMa; }
+  uint8_t getQueueLength() const { return heapSize; }
+  void setBudgetMa(uint16_t ma) { budgetMa = ma; }
+  void setSpacingMs(uint16_t ms) { spacingMs = ms; }
+  uint32_t getLastOffLatencyUs() const { return lastOffLatencyUs; }
+  uint32_t getWorstOffLatencyUs() const { return worstOffLatencyUs; }
+  void resetLatency() { lastOffLatencyUs = worstOffLatencyUs = 0; }
+};
+
+#endif
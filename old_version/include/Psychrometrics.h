@@ -0,0 +1,89 @@
+#ifndef PSYCHROMETRICS_H
+#define PSYCHROMETRICS_H
+
+#include <math.h>
+
+// Moist-air quantities from air temperature (degC) and relative humidity
+// (%RH), all in float without pow()/exp()/log().
+//
+// Reference is the Magnus formula with the Alduchov-Eskridge constants,
+//   es(T) = 0.61094 exp(17.625 T / (T + 243.04)) kPa,
+// which itself is within 0.4 % of the WMO/Goff-Gratch values over water
+// from -40 to 50 degC. Against that reference, over -20..60 degC and
+// 1..100 %RH (measured by test/test_psychrometrics):
+//   saturationVp()      degree-6 minimax polynomial, relative error < 1.5e-5
+//   vpd(), vapourPressure(), absoluteHumidity()   same relative error
+//   dewPoint()          exact inverse with a series log, error < 2e-5 degC
+//   heatIndex()         Rothfusz/Steadman as in the NWS reference, in float;
+//                       within 0.005 degC of the double pow() form
+// NAN in gives NAN out, so an unknown reading stays unknown.
+class Psychrometrics {
+private:
+  static constexpr float magnusB = 17.625f;
+  static constexpr float magnusC = 243.04f;   // degC
+
+  // ln(x) for x > 0: split off the binary exponent, then the atanh series
+  // on a mantissa within [0.71, 1.41] (|s| < 0.172, next term < 2e-8).
+  static float ln(float x) {
+    int e;
+    float m = frexpf(x, &e);
+    if (m < 0.70710678f) {
+      m *= 2.0f;
+      e--;
+    }
+    float s = (m - 1.0f) / (m + 1.0f);
+    float s2 = s * s;
+    return e * 0.69314718f +
+           2.0f * s * (1.0f + s2 * (1.0f / 3.0f + s2 * (1.0f / 5.0f + s2 * (1.0f / 7.0f))));
+  }
+
+public:
+  // Saturation vapour pressure over water, kPa.
+  static float saturationVp(float t) {
+    return 6.1094892e-01f + t * (4.4305488e-02f + t * (1.4239672e-03f + t * (2.6351932e-05f +
+           t * (3.0386155e-07f + t * (2.1531492e-09f + t * 6.9313197e-12f)))));
+  }
+
+  // Actual vapour pressure, kPa.
+  static float vapourPressure(float t, float rh) {
+    return saturationVp(t) * rh * 0.01f;
+  }
+
+  // Vapour-pressure deficit, kPa. With a leaf temperature offset (leaves run
+  // 1-3 degC below air under lights) this is the leaf-to-air VPD.
+  static float vpd(float t, float rh, float leafOffset = 0.0f) {
+    float leaf = leafOffset == 0.0f ? saturationVp(t) : saturationVp(t + leafOffset);
+    return leaf - vapourPressure(t, rh);
+  }
+
+  // Dew point, degC. NAN for a dry (0 %) reading.
+  static float dewPoint(float t, float rh) {
+    if (!(rh > 0.0f)) return NAN;
+    float g = ln(rh * 0.01f) + magnusB * t / (magnusC + t);
+    return magnusC * g / (magnusB - g);
+  }
+
+  // Absolute humidity, g/m3 (ideal gas, water vapour).
+  static float absoluteHumidity(float t, float rh) {
+    return 2167.4f * vapourPressure(t, rh) / (t + 273.15f);
+  }
+
+  // Apparent temperature, degC: Steadman's simple formula, or the Rothfusz
+  // regression with the NWS corrections above 80 degF, in Horner form.
+  static float heatIndex(float t, float rh) {
+    float f = t * 1.8f + 32.0f;
+    float hi = 0.5f * (f + 61.0f + (f - 68.0f) * 1.2f + rh * 0.094f);
+    if (hi > 79.0f) {
+      hi = (-42.379f + f * (2.04901523f + f * -0.00683783f)) +
+           rh * ((10.14333127f + f * (-0.22475541f + f * 0.00122874f)) +
+                 rh * (-0.05481717f + f * (0.00085282f + f * -0.00000199f)));
+      if (rh < 13.0f && f >= 80.0f && f <= 112.0f)
+        hi -= (13.0f - rh) * 0.25f * sqrtf((17.0f - fabsf(f - 95.0f)) * 0.05882f);
+      else if (rh > 85.0f && f >= 80.0f && f <= 87.0f)
+        hi += (rh - 85.0f) * 0.1f * ((87.0f - f) * 0.2f);
+    }
+    return (hi - 32.0f) * (1.0f / 1.8f);
+  }
+};
+
+#endif
@@ -0,0 +1,417 @@
+#ifndef RULE_ENGINE_H
+#define RULE_ENGINE_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "ZoneTable.h"
+
+#define RULE_MAX        64
+#define RULE_CODE_SIZE  48
+#define RULE_STACK      8
+#define RULE_TEXT_SIZE  128
+
+// Rule inputs; each is one bit of a rule's dependency mask.
+#define RULE_IN_TEMPERATURE 0   // degC
+#define RULE_IN_HUMIDITY    1   // %RH
+#define RULE_IN_HOUR        2
+#define RULE_IN_MINUTE      3
+#define RULE_IN_DOW         4   // 1 = Monday
+#define RULE_IN_VPD         5   // kPa
+#define RULE_IN_DEWPOINT    6   // degC
+#define RULE_IN_MOISTURE(z) (7 + (z))   // %
+#define RULE_INPUTS         RULE_IN_MOISTURE(MAX_ZONES)
+
+enum RuleOp : uint8_t {
+  RULE_OP_END,
+  RULE_OP_INPUT,    // + input id
+  RULE_OP_CONST,    // + float
+  RULE_OP_LT, RULE_OP_LE, RULE_OP_GT, RULE_OP_GE, RULE_OP_EQ, RULE_OP_NE,
+  RULE_OP_IN,       // x lo hi -> lo <= x <= hi
+  RULE_OP_AND, RULE_OP_OR, RULE_OP_NOT
+};
+
+enum RuleAction : uint8_t {
+  RULE_ACT_DOSE,    // zone, ml (0 = the zone's configured dose)
+};
+
+struct Rule {
+  uint8_t code[RULE_CODE_SIZE];
+  uint8_t length;
+  uint32_t deps;      // inputs the condition reads
+  RuleAction action;
+  uint8_t zone;
+  uint16_t arg;
+  bool active;        // condition held at the last evaluation
+};
+
+// User-defined control rules, e.g.
+//   when zone1.moisture < 22 and hour in 6..9 then dose zone1 40ml
+// Each rule is compiled once into stack bytecode. Inputs are pushed with
+// setInput(); evaluate() only re-runs rules that read an input which
+// changed since the last call, and fires a rule's action when its
+// condition goes from false to true; a rule that reads an unknown (NAN)
+// input holds false. Sources live in NVS and are recompiled at boot.
+class RuleEngine {
+public:
+  typedef void (*ActionHandler)(RuleAction action, uint8_t zone, uint16_t arg);
+
+private:
+  Rule rules[RULE_MAX];
+  uint8_t count;
+  float inputs[RULE_INPUTS];
+  uint32_t dirty;
+  ActionHandler handler;
+  uint32_t lastEvalUs;
+  uint8_t lastEvaluated;
+
+  // --- compiler ---
+
+  struct Parser {
+    const char *p;
+    Rule *out;
+    const char *error;
+  };
+
+  static void skipSpace(Parser &ps) {
+    while (*ps.p == ' ' || *ps.p == '\t') ps.p++;
+  }
+
+  // Consumes word if it is next (whole word only).
+  static bool keyword(Parser &ps, const char *word) {
+    skipSpace(ps);
+    size_t n = strlen(word);
+    if (strncasecmp(ps.p, word, n) != 0) return false;
+    char c = ps.p[n];
+    if (isalnum((unsigned char)c) || c == '_' || c == '.') return false;
+    ps.p += n;
+    return true;
+  }
+
+  static bool symbol(Parser &ps, const char *sym) {
+    skipSpace(ps);
+    size_t n = strlen(sym);
+    if (strncmp(ps.p, sym, n) != 0) return false;
+    ps.p += n;
+    return true;
+  }
+
+  static bool emit(Parser &ps, uint8_t byte) {
+    if (ps.out->length >= RULE_CODE_SIZE - 1) {
+      ps.error = "rule too long";
+      return false;
+    }
+    ps.out->code[ps.out->length++] = byte;
+    return true;
+  }
+
+  static bool emitConst(Parser &ps, float v) {
+    if (!emit(ps, RULE_OP_CONST)) return false;
+    if (ps.out->length + sizeof(float) > RULE_CODE_SIZE - 1) {
+      ps.error = "rule too long";
+      return false;
+    }
+    memcpy(ps.out->code + ps.out->length, &v, sizeof(float));
+    ps.out->length += sizeof(float);
+    return true;
+  }
+
+  static bool number(Parser &ps, float &v) {
+    skipSpace(ps);
+    const char *s = ps.p;
+    bool neg = *s == '-';
+    if (neg) s++;
+    if (!isdigit((unsigned char)*s)) return false;
+    v = 0;
+    while (isdigit((unsigned char)*s)) v = v * 10 + (*s++ - '0');
+    // A single '.' followed by a digit is a fraction; ".." is a range.
+    if (s[0] == '.' && isdigit((unsigned char)s[1])) {
+      float scale = 0.1f;
+      for (s++; isdigit((unsigned char)*s); s++, scale *= 0.1f) v += (*s - '0') * scale;
+    }
+    if (neg) v = -v;
+    ps.p = s;
+    return true;
+  }
+
+  // zone1..zone16, returned 0-based.
+  static bool zoneName(Parser &ps, uint8_t &z) {
+    skipSpace(ps);
+    if (strncasecmp(ps.p, "zone", 4) != 0 || !isdigit((unsigned char)ps.p[4])) return false;
+    char *end;
+    long n = strtol(ps.p + 4, &end, 10);
+    if (n < 1 || n > MAX_ZONES) {
+      ps.error = "no such zone";
+      return false;
+    }
+    z = n - 1;
+    ps.p = end;
+    return true;
+  }
+
+  static bool operand(Parser &ps) {
+    float v;
+    if (number(ps, v)) return emitConst(ps, v);
+
+    uint8_t id, z;
+    if (zoneName(ps, z)) {
+      if (!symbol(ps, ".") || !keyword(ps, "moisture")) {
+        if (!ps.error) ps.error = "expected zoneN.moisture";
+        return false;
+      }
+      id = RULE_IN_MOISTURE(z);
+    } else if (keyword(ps, "temperature") || keyword(ps, "temp")) {
+      id = RULE_IN_TEMPERATURE;
+    } else if (keyword(ps, "humidity") || keyword(ps, "hum")) {
+      id = RULE_IN_HUMIDITY;
+    } else if (keyword(ps, "vpd")) {
+      id = RULE_IN_VPD;
+    } else if (keyword(ps, "dewpoint")) {
+      id = RULE_IN_DEWPOINT;
+    } else if (keyword(ps, "hour")) {
+      id = RULE_IN_HOUR;
+    } else if (keyword(ps, "minute")) {
+      id = RULE_IN_MINUTE;
+    } else if (keyword(ps, "dow")) {
+      id = RULE_IN_DOW;
+    } else {
+      if (!ps.error) ps.error = "expected a value";
+      return false;
+    }
+    ps.out->deps |= 1UL << id;
+    return emit(ps, RULE_OP_INPUT) && emit(ps, id);
+  }
+
+  static bool comparison(Parser &ps) {
+    if (!operand(ps)) return false;
+    if (keyword(ps, "in")) {
+      float lo, hi;
+      if (!number(ps, lo) || !symbol(ps, "..") || !number(ps, hi)) {
+        ps.error = "expected lo..hi";
+        return false;
+      }
+      return emitConst(ps, lo) && emitConst(ps, hi) && emit(ps, RULE_OP_IN);
+    }
+
+    static const struct { const char *sym; RuleOp op; } ops[] = {
+      {"<=", RULE_OP_LE}, {">=", RULE_OP_GE}, {"==", RULE_OP_EQ}, {"!=", RULE_OP_NE},
+      {"<", RULE_OP_LT}, {">", RULE_OP_GT}, {"=", RULE_OP_EQ},
+    };
+    for (const auto &o : ops) {
+      if (symbol(ps, o.sym)) return operand(ps) && emit(ps, o.op);
+    }
+    ps.error = "expected a comparison";
+    return false;
+  }
+
+  static bool expression(Parser &ps);
+
+  static bool factor(Parser &ps) {
+    if (keyword(ps, "not")) return factor(ps) && emit(ps, RULE_OP_NOT);
+    if (symbol(ps, "(")) {
+      if (!expression(ps)) return false;
+      if (!symbol(ps, ")")) {
+        ps.error = "expected )";
+        return false;
+      }
+      return true;
+    }
+    return comparison(ps);
+  }
+
+  static bool term(Parser &ps) {
+    if (!factor(ps)) return false;
+    while (keyword(ps, "and")) {
+      if (!factor(ps) || !emit(ps, RULE_OP_AND)) return false;
+    }
+    return true;
+  }
+
+  static bool action(Parser &ps) {
+    if (keyword(ps, "dose") || keyword(ps, "water")) {
+      if (!zoneName(ps, ps.out->zone)) {
+        if (!ps.error) ps.error = "expected zoneN";
+        return false;
+      }
+      float ml = 0;
+      if (number(ps, ml)) keyword(ps, "ml");
+      if (ml < 0 || ml > 5000) {
+        ps.error = "bad volume";
+        return false;
+      }
+      ps.out->action = RULE_ACT_DOSE;
+      ps.out->arg = (uint16_t)ml;
+      return true;
+    }
+    ps.error = "expected an action (dose)";
+    return false;
+  }
+
+  // --- evaluator ---
+
+  bool run(const Rule &r) const {
+    float stack[RULE_STACK];
+    uint8_t sp = 0;
+    for (uint8_t pc = 0; pc < r.length;) {
+      uint8_t op = r.code[pc++];
+      switch (op) {
+        case RULE_OP_END:
+          return sp > 0 && stack[sp - 1] != 0;
+        case RULE_OP_INPUT:
+          if (sp >= RULE_STACK) return false;
+          stack[sp] = inputs[r.code[pc++]];
+          if (isnan(stack[sp++])) return false;   // unknown input: rule holds false
+          break;
+        case RULE_OP_CONST:
+          if (sp >= RULE_STACK) return false;
+          memcpy(&stack[sp++], r.code + pc, sizeof(float));
+          pc += sizeof(float);
+          break;
+        case RULE_OP_NOT:
+          stack[sp - 1] = stack[sp - 1] == 0;
+          break;
+        case RULE_OP_IN:
+          sp -= 2;
+          stack[sp - 1] = stack[sp - 1] >= stack[sp] && stack[sp - 1] <= stack[sp + 1];
+          break;
+        default: {
+          float b = stack[--sp];
+          float &a = stack[sp - 1];
+          switch (op) {
+            case RULE_OP_LT:  a = a < b; break;
+            case RULE_OP_LE:  a = a <= b; break;
+            case RULE_OP_GT:  a = a > b; break;
+            case RULE_OP_GE:  a = a >= b; break;
+            case RULE_OP_EQ:  a = a == b; break;
+            case RULE_OP_NE:  a = a != b; break;
+            case RULE_OP_AND: a = a != 0 && b != 0; break;
+            case RULE_OP_OR:  a = a != 0 || b != 0; break;
+          }
+        }
+      }
+    }
+    return false;
+  }
+
+  static void key(char *buf, size_t size, uint8_t i) {
+    snprintf(buf, size, "r%u", (unsigned)i);
+  }
+
+public:
+  RuleEngine() : count(0), dirty(0), handler(nullptr), lastEvalUs(0), lastEvaluated(0) {
+    for (uint8_t i = 0; i < RULE_INPUTS; i++) inputs[i] = NAN;
+  }
+
+  void setHandler(ActionHandler h) { handler = h; }
+
+  // Compiles "when <condition> then <action>"; on failure returns false
+  // and points error at a message.
+  static bool compile(const char *text, Rule &out, const char *&error) {
+    memset(&out, 0, sizeof(out));
+    Parser ps = {text, &out, nullptr};
+    bool ok = keyword(ps, "when") && expression(ps) && keyword(ps, "then") && action(ps);
+    if (ok) {
+      skipSpace(ps);
+      if (*ps.p != '\0') {
+        ps.error = "unexpected text after the action";
+        ok = false;
+      }
+    } else if (!ps.error) {
+      ps.error = "expected: when <condition> then <action>";
+    }
+    if (ok) ok = emit(ps, RULE_OP_END);
+    error = ps.error;
+    return ok;
+  }
+
+  // Adds a compiled rule; it is evaluated on the next call.
+  bool add(const Rule &r) {
+    if (count >= RULE_MAX) return false;
+    rules[count] = r;
+    rules[count].active = false;
+    dirty |= r.deps;
+    count++;
+    return true;
+  }
+
+  bool remove(uint8_t i) {
+    if (i >= count) return false;
+    memmove(&rules[i], &rules[i + 1], (count - i - 1) * sizeof(Rule));
+    count--;
+    return true;
+  }
+
+  void setInput(uint8_t id, float value) {
+    if (id >= RULE_INPUTS) return;
+    // NAN != NAN, so compare bit patterns to notice "still unknown".
+    if (memcmp(&inputs[id], &value, sizeof(float)) == 0) return;
+    inputs[id] = value;
+    dirty |= 1UL << id;
+  }
+
+  // Re-runs rules whose inputs changed; fires actions on rising edges.
+  void evaluate() {
+    if (!dirty) return;
+    unsigned long t0 = micros();
+    uint32_t changed = dirty;
+    dirty = 0;
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      Rule &r = rules[i];
+      if (!(r.deps & changed)) continue;
+      n++;
+      bool now = run(r);
+      if (now && !r.active && handler) handler(r.action, r.zone, r.arg);
+      r.active = now;
+    }
+    lastEvalUs = micros() - t0;
+    lastEvaluated = n;
+  }
+
+  // Rule sources are stored as typed, slot i = rule i.
+  static bool saveText(uint8_t i, const char *text) {
+    char k[8];
+    key(k, sizeof(k), i);
+    Preferences prefs;
+    prefs.begin("rules", false);
+    bool ok = prefs.putString(k, text) > 0;
+    prefs.end();
+    return ok;
+  }
+
+  static bool loadText(uint8_t i, char *text, size_t size) {
+    char k[8];
+    key(k, sizeof(k), i);
+    Preferences prefs;
+    prefs.begin("rules", true);
+    size_t n = prefs.getString(k, text, size);
+    prefs.end();
+    return n > 0;
+  }
+
+  // Drops the stored sources in slots first..RULE_MAX-1.
+  static void eraseFrom(uint8_t first) {
+    Preferences prefs;
+    prefs.begin("rules", false);
+    for (uint8_t i = first; i < RULE_MAX; i++) {
+      char k[8];
+      key(k, sizeof(k), i);
+      if (prefs.isKey(k)) prefs.remove(k);
+    }
+    prefs.end();
+  }
+
+  uint8_t size() const { return count; }
+  const Rule &get(uint8_t i) const { return rules[i]; }
+  uint32_t getLastEvalUs() const { return lastEvalUs; }
+  uint8_t getLastEvaluated() const { return lastEvaluated; }
+};
+
+inline bool RuleEngine::expression(Parser &ps) {
+  if (!term(ps)) return false;
+  while (keyword(ps, "or")) {
+    if (!term(ps) || !emit(ps, RULE_OP_OR)) return false;
+  }
+  return true;
+}
+
+#endif
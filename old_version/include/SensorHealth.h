@@ -0,0 +1,147 @@
+#ifndef SENSOR_HEALTH_H
+#define SENSOR_HEALTH_H
+
+#include <Arduino.h>
+
+// Online fault detection for one sensor channel. Every published reading
+// goes through check(), which is O(1): a handful of comparisons against
+// the previous reading and the channel's limits. A channel is degraded
+// after DEGRADE_AFTER bad readings in a row and healthy again after
+// RECOVER_AFTER good ones, so one odd reading neither trips nor clears it.
+// Consumers stop acting on a degraded channel (no watering, no rules)
+// until it recovers.
+
+enum SensorFault : uint8_t {
+  FAULT_RANGE   = 1 << 0,   // outside what a connected sensor reads (open/short)
+  FAULT_STUCK   = 1 << 1,   // same value and no noise for too long
+  FAULT_NOISE   = 1 << 2,   // spread above the limit (floating input, bad contact)
+  FAULT_RATE    = 1 << 3,   // changed faster than the medium can
+  FAULT_CROSS   = 1 << 4,   // off its calibration while the other zones are not
+  FAULT_MISSING = 1 << 5,   // no reading (DHT timeouts)
+};
+
+struct SensorLimits {
+  float min, max;           // plausible range
+  float maxNoise;           // spread (standard deviation) limit
+  float maxStep;            // change allowed between two readings ...
+  float maxRate;            // ... plus this much per second between them
+  float stuckDelta;         // change and spread below this count as "same"
+  uint8_t stuckCount;       // same readings in a row that mean stuck; 0 = off
+};
+
+class SensorHealth {
+private:
+  const SensorLimits *limits;
+  float last;               // last reading that passed, NAN before the first
+  uint32_t lastAt;
+  uint8_t sameCount;
+  uint8_t badRun;
+  uint8_t goodRun;
+  uint8_t current;          // faults of the latest reading
+  uint8_t seen;             // faults since the channel last became healthy
+  bool degraded;
+  uint32_t faultReadings;
+
+  static const uint8_t DEGRADE_AFTER = 2;
+  static const uint8_t RECOVER_AFTER = 3;
+
+  void settle(uint8_t faults) {
+    current = faults;
+    if (faults) {
+      faultReadings++;
+      seen |= faults;
+      goodRun = 0;
+      if (badRun < 255) badRun++;
+      if (badRun >= DEGRADE_AFTER) degraded = true;
+    } else {
+      badRun = 0;
+      if (goodRun < 255) goodRun++;
+      if (degraded && goodRun >= RECOVER_AFTER) {
+        degraded = false;
+        seen = 0;
+      }
+    }
+  }
+
+public:
+  SensorHealth() : limits(nullptr) { reset(); }
+
+  void begin(const SensorLimits &l) {
+    limits = &l;
+    reset();
+  }
+
+  void reset() {
+    last = NAN;
+    lastAt = 0;
+    sameCount = 0;
+    badRun = 0;
+    goodRun = 0;
+    current = 0;
+    seen = 0;
+    degraded = false;
+    faultReadings = 0;
+  }
+
+  // Checks one reading and its spread taken at now (ms). extra holds faults
+  // found outside (FAULT_CROSS); rateExempt skips the rate check while the
+  // value is expected to move fast (just watered). Returns the faults.
+  uint8_t check(float value, float noise, uint32_t now, bool rateExempt = false,
+                uint8_t extra = 0) {
+    if (isnan(value)) return missing();
+    const SensorLimits &l = *limits;
+    uint8_t faults = extra;
+
+    if (value < l.min || value > l.max) faults |= FAULT_RANGE;
+    if (noise > l.maxNoise) faults |= FAULT_NOISE;
+
+    if (!isnan(last)) {
+      float step = fabsf(value - last);
+      if (!rateExempt && step > l.maxStep + l.maxRate * ((now - lastAt) / 1000.0f)) {
+        faults |= FAULT_RATE;
+      }
+      if (step <= l.stuckDelta && noise <= l.stuckDelta) {
+        if (sameCount < 255) sameCount++;
+      } else {
+        sameCount = 0;
+      }
+      if (l.stuckCount && sameCount >= l.stuckCount) faults |= FAULT_STUCK;
+    }
+
+    // A rejected reading is no baseline for the next rate check. Once the
+    // channel is degraded, follow an in-range jump anyway so a sensor whose
+    // level really moved can recover.
+    bool usable = !(faults & (FAULT_RANGE | FAULT_NOISE));
+    if (isnan(last) || (usable && (!(faults & FAULT_RATE) || degraded))) {
+      last = value;
+      lastAt = now;
+    }
+    settle(faults);
+    return faults;
+  }
+
+  // A reading that did not arrive.
+  uint8_t missing() {
+    settle(FAULT_MISSING);
+    return FAULT_MISSING;
+  }
+
+  bool isDegraded() const { return degraded; }
+  uint8_t getFaults() const { return current; }
+  // Faults since the channel was last healthy, for the display and console.
+  uint8_t getSeen() const { return degraded ? seen : current; }
+  uint32_t getFaultReadings() const { return faultReadings; }
+
+  // Short name of the most important fault, at most 5 characters.
+  static const char *name(uint8_t faults) {
+    if (faults & FAULT_MISSING) return "nodat";
+    if (faults & FAULT_RANGE) return "range";
+    if (faults & FAULT_STUCK) return "stuck";
+    if (faults & FAULT_CROSS) return "cross";
+    if (faults & FAULT_RATE) return "jump";
+    if (faults & FAULT_NOISE) return "noise";
+    return "ok";
+  }
+};
+
+#endif
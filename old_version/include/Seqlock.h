@@ -0,0 +1,44 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Single-writer sequence lock. The writer never waits: it makes the
+// sequence odd, copies the value in and makes it even again. Readers copy
+// the value out and retry if the sequence was odd or moved meanwhile, so
+// they always get a consistent copy. T must be trivially copyable.
+template <typename T>
+class Seqlock {
+private:
+  std::atomic<uint32_t> seq;
+  T value;
+
+public:
+  Seqlock() : seq(0) { memset(&value, 0, sizeof(value)); }
+
+  void write(const T &v) {
+    uint32_t s = seq.load(std::memory_order_relaxed);
+    seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&value, &v, sizeof(T));
+    seq.store(s + 2, std::memory_order_release);
+  }
+
+  void read(T &out) const {
+    uint32_t before, after;
+    do {
+      before = seq.load(std::memory_order_acquire);
+      if (before & 1) continue;
+      memcpy(&out, &value, sizeof(T));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = seq.load(std::memory_order_relaxed);
+      if (after == before) return;
+    } while (true);
+  }
+
+  // Even and bumped by 2 per write; lets readers skip unchanged values.
+  uint32_t getSequence() const { return seq.load(std::memory_order_acquire); }
+};
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef SERIAL_CONSOLE_H
+#define SERIAL_CONSOLE_H
+
+#include <Arduino.h>
+#include "SpscRing.h"
+
+#define CONSOLE_LINE_SIZE 128   // fits a rule ("rule add when ... then ...")
+#define CONSOLE_MAX_ARGS  24
+#define CONSOLE_OUT_SIZE  2048   // bytes buffered between tasks
+
+typedef void (*ConsoleHandler)(int argc, char **argv);
+
+struct ConsoleCommand {
+  const char *name;
+  const char *usage;
+  ConsoleHandler handler;
+};
+
+struct ConsoleLine {
+  char text[CONSOLE_LINE_SIZE];
+};
+
+// Print that queues its output for another task to write out, so the
+// producer never waits on the UART. Output that does not fit is dropped.
+class RingPrint : public Print {
+private:
+  SpscRing<uint8_t, CONSOLE_OUT_SIZE> ring;
+
+public:
+  size_t write(uint8_t c) override { return ring.push(c) ? 1 : 0; }
+
+  size_t write(const uint8_t *buf, size_t size) override {
+    size_t n = 0;
+    while (n < size && ring.push(buf[n])) n++;
+    return n;
+  }
+
+  // Consumer side: copies queued output to out.
+  void drainTo(Print &out) {
+    uint8_t buf[64];
+    size_t n = 0;
+    uint8_t c;
+    while (ring.pop(c)) {
+      buf[n++] = c;
+      if (n == sizeof(buf)) {
+        out.write(buf, n);
+        n = 0;
+      }
+    }
+    if (n) out.write(buf, n);
+  }
+
+  uint32_t getDropped() const { return ring.getDropped(); }
+};
+
+// Line-based command console. Input always comes from Serial; replies go
+// to out. readLine() only drains what is already buffered, so it never
+// blocks, and lines can be handed to another task to execute().
+class SerialConsole {
+private:
+  const ConsoleCommand *commands;
+  uint8_t commandCount;
+  Print &out;
+  char line[CONSOLE_LINE_SIZE];
+  uint8_t length;
+
+public:
+  SerialConsole(const ConsoleCommand *cmds, uint8_t n, Print &o = Serial)
+    : commands(cmds), commandCount(n), out(o), length(0) {}
+
+  // Copies the next complete line into buf (CONSOLE_LINE_SIZE bytes);
+  // false when no line is complete yet.
+  bool readLine(char *buf) {
+    while (Serial.available() > 0) {
+      int ch = Serial.read();
+      if (ch == '\n' || ch == '\r') {
+        if (length > 0) {
+          memcpy(buf, line, length);
+          buf[length] = '\0';
+          length = 0;
+          return true;
+        }
+      } else if (length < CONSOLE_LINE_SIZE - 1) {
+        line[length++] = (char)ch;
+      } else {
+        Serial.println("Command too long, dropped");
+        length = 0;
+      }
+    }
+    return false;
+  }
+
+  // Tokenises line in place and runs the matching command.
+  void execute(char *text) {
+    char *argv[CONSOLE_MAX_ARGS];
+    int argc = 0;
+    char *save = nullptr;
+    for (char *tok = strtok_r(text, " \t", &save);
+         tok && argc < CONSOLE_MAX_ARGS;
+         tok = strtok_r(nullptr, " \t", &save)) {
+      argv[argc++] = tok;
+    }
+    if (argc == 0) return;
+
+    for (uint8_t i = 0; i < commandCount; i++) {
+      if (strcmp(argv[0], commands[i].name) == 0) {
+        commands[i].handler(argc, argv);
+        return;
+      }
+    }
+
+    out.print("Unknown command: ");
+    out.println(argv[0]);
+    printHelp();
+  }
+
+  void update() {
+    char buf[CONSOLE_LINE_SIZE];
+    while (readLine(buf)) execute(buf);
+  }
+
+  void printHelp() const {
+    for (uint8_t i = 0; i < commandCount; i++) {
+      out.print("  ");
+      out.println(commands[i].usage);
+    }
+  }
+};
+
+#endif
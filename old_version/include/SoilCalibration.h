@@ -0,0 +1,146 @@
+#ifndef SOIL_CALIBRATION_H
+#define SOIL_CALIBRATION_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+#define SOIL_CAL_MAX_POINTS 8
+#define SOIL_CAL_NAMESPACE  "soilcal"
+
+// Per-probe calibration: probe voltage (mV) -> volumetric moisture in 0.1 %
+// steps, evaluated as an integer piecewise-linear curve. Slopes are kept in
+// Q16 so a lookup is a 3-step binary search plus one multiply.
+class SoilCalibration {
+private:
+  struct Stored {
+    uint8_t count;
+    uint16_t mv[SOIL_CAL_MAX_POINTS];
+    int16_t permille[SOIL_CAL_MAX_POINTS];
+  };
+
+  uint8_t count;
+  uint16_t mv[SOIL_CAL_MAX_POINTS];        // ascending
+  int16_t permille[SOIL_CAL_MAX_POINTS];   // moisture x10 at mv[i]
+  int32_t slope[SOIL_CAL_MAX_POINTS - 1];  // Q16 permille per mV
+
+  void rebuildSlopes() {
+    for (uint8_t i = 0; i + 1 < count; i++) {
+      int32_t dv = (int32_t)mv[i + 1] - mv[i];
+      int32_t dp = (int32_t)permille[i + 1] - permille[i];
+      slope[i] = dv > 0 ? (dp * 65536L) / dv : 0;
+    }
+  }
+
+public:
+  SoilCalibration() { setDefault(); }
+
+  // Two-point equivalent of the original linear model V = a*h + b
+  // (a = -1.176, b = 1.77): 1770 mV is dry, 594 mV is saturated.
+  void setDefault() {
+    count = 2;
+    mv[0] = 594;  permille[0] = 1000;
+    mv[1] = 1770; permille[1] = 0;
+    rebuildSlopes();
+  }
+
+  void clear() { count = 0; }
+
+  // Inserts a point keeping mv[] sorted; an existing point at the same
+  // voltage is replaced. Returns false when the table is full.
+  bool addPoint(uint16_t pointMv, int16_t pointPermille) {
+    if (pointPermille < 0) pointPermille = 0;
+    if (pointPermille > 1000) pointPermille = 1000;
+
+    uint8_t i = 0;
+    while (i < count && mv[i] < pointMv) i++;
+    if (i < count && mv[i] == pointMv) {
+      permille[i] = pointPermille;
+    } else {
+      if (count >= SOIL_CAL_MAX_POINTS) return false;
+      for (uint8_t j = count; j > i; j--) {
+        mv[j] = mv[j - 1];
+        permille[j] = permille[j - 1];
+      }
+      mv[i] = pointMv;
+      permille[i] = pointPermille;
+      count++;
+    }
+    rebuildSlopes();
+    return true;
+  }
+
+  bool isUsable() const { return count >= 2; }
+  uint8_t size() const { return count; }
+  uint16_t pointMv(uint8_t i) const { return mv[i]; }
+  int16_t pointPermille(uint8_t i) const { return permille[i]; }
+
+  // Moisture in 0.1 % for a probe voltage, clamped to the table ends.
+  int16_t evaluate(uint16_t x) const {
+    if (count < 2) return -1;
+    if (x <= mv[0]) return permille[0];
+    if (x >= mv[count - 1]) return permille[count - 1];
+
+    // Largest i with mv[i] <= x, i in [0, count-2].
+    uint8_t lo = 0, hi = count - 1;
+    while (hi - lo > 1) {
+      uint8_t mid = (lo + hi) >> 1;
+      if (mv[mid] <= x) lo = mid;
+      else hi = mid;
+    }
+
+    int32_t p = permille[lo] +
+                (int32_t)(((int64_t)slope[lo] * (x - mv[lo]) + 32768) >> 16);
+    if (p < 0) p = 0;
+    if (p > 1000) p = 1000;
+    return (int16_t)p;
+  }
+
+  bool load(uint8_t probe) {
+    Preferences prefs;
+    char key[8];
+    snprintf(key, sizeof(key), "p%u", (unsigned)probe);
+
+    Stored s;
+    bool ok = false;
+    prefs.begin(SOIL_CAL_NAMESPACE, true);
+    if (prefs.getBytesLength(key) == sizeof(s) &&
+        prefs.getBytes(key, &s, sizeof(s)) == sizeof(s) &&
+        s.count >= 2 && s.count <= SOIL_CAL_MAX_POINTS) {
+      count = 0;
+      for (uint8_t i = 0; i < s.count; i++) addPoint(s.mv[i], s.permille[i]);
+      ok = true;
+    }
+    prefs.end();
+    return ok;
+  }
+
+  bool save(uint8_t probe) const {
+    if (count < 2) return false;
+
+    Preferences prefs;
+    char key[8];
+    snprintf(key, sizeof(key), "p%u", (unsigned)probe);
+
+    Stored s;
+    memset(&s, 0, sizeof(s));
+    s.count = count;
+    memcpy(s.mv, mv, sizeof(mv));
+    memcpy(s.permille, permille, sizeof(permille));
+
+    prefs.begin(SOIL_CAL_NAMESPACE, false);
+    bool ok = prefs.putBytes(key, &s, sizeof(s)) == sizeof(s);
+    prefs.end();
+    return ok;
+  }
+
+  static void erase(uint8_t probe) {
+    Preferences prefs;
+    char key[8];
+    snprintf(key, sizeof(key), "p%u", (unsigned)probe);
+    prefs.begin(SOIL_CAL_NAMESPACE, false);
+    prefs.remove(key);
+    prefs.end();
+  }
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Lock-free single-producer/single-consumer ring. One task (or ISR) only
+// pushes, one only pops; neither ever blocks. N must be a power of two
+// no larger than 32768.
+template <typename T, uint16_t N>
+class SpscRing {
+private:
+  static_assert((N & (N - 1)) == 0, "ring size must be a power of two");
+
+  T items[N];
+  std::atomic<uint16_t> head;   // written by the producer only
+  std::atomic<uint16_t> tail;   // written by the consumer only
+  std::atomic<uint32_t> dropped;
+
+public:
+  SpscRing() : head(0), tail(0), dropped(0) {}
+
+  // Producer side; false (and counted) when full.
+  bool push(const T &item) {
+    uint16_t h = head.load(std::memory_order_relaxed);
+    if ((uint16_t)(h - tail.load(std::memory_order_acquire)) >= N) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    items[h & (N - 1)] = item;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side; false when empty.
+  bool pop(T &item) {
+    uint16_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) return false;
+    item = items[t & (N - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  uint16_t size() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+  uint32_t getDropped() const { return dropped.load(std::memory_order_relaxed); }
+};
+
+#endif
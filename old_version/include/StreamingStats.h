@@ -0,0 +1,227 @@
+#ifndef STREAMING_STATS_H
+#define STREAMING_STATS_H
+
+#include <Arduino.h>
+
+// O(1), allocation-free streaming estimators shared by every sensor.
+// Each one consumes samples with add() and can be read at any time.
+
+// Mean and variance with Welford's update (no catastrophic cancellation).
+template <typename T = float>
+class RunningStats {
+private:
+  uint32_t n;
+  T m;
+  T m2;
+
+public:
+  RunningStats() { reset(); }
+
+  void reset() {
+    n = 0;
+    m = 0;
+    m2 = 0;
+  }
+
+  void add(T x) {
+    n++;
+    T d = x - m;
+    m += d / n;
+    m2 += d * (x - m);
+  }
+
+  uint32_t count() const { return n; }
+  T mean() const { return n ? m : (T)NAN; }
+  // Sample variance (n - 1); zero until there are two samples.
+  T variance() const { return n > 1 ? m2 / (n - 1) : 0; }
+  T stddev() const { return sqrt(variance()); }
+};
+
+// Exponentially weighted mean and variance. alpha is the weight of the
+// newest sample; the first sample seeds the mean.
+template <typename T = float>
+class Ewma {
+private:
+  T alpha;
+  T m;
+  T var;
+  bool seeded;
+
+public:
+  Ewma(T a) : alpha(a) { reset(); }
+
+  void reset() {
+    m = 0;
+    var = 0;
+    seeded = false;
+  }
+
+  void add(T x) {
+    if (!seeded) {
+      m = x;
+      seeded = true;
+      return;
+    }
+    T d = x - m;
+    m += alpha * d;
+    var = (1 - alpha) * (var + alpha * d * d);
+  }
+
+  bool ready() const { return seeded; }
+  T mean() const { return seeded ? m : (T)NAN; }
+  T variance() const { return var; }
+  T stddev() const { return sqrt(var); }
+  void setAlpha(T a) { alpha = a; }
+};
+
+template <typename T = float>
+class MinMax {
+private:
+  T lo;
+  T hi;
+  bool empty;
+
+public:
+  MinMax() { reset(); }
+
+  void reset() { empty = true; }
+
+  void add(T x) {
+    if (empty || x < lo) lo = x;
+    if (empty || x > hi) hi = x;
+    empty = false;
+  }
+
+  T lowest() const { return empty ? (T)NAN : lo; }
+  T highest() const { return empty ? (T)NAN : hi; }
+  T range() const { return empty ? 0 : hi - lo; }
+};
+
+// P-square quantile estimator (Jain & Chlamtac): five markers track the
+// p-quantile without storing samples. Until five samples arrive the exact
+// quantile of what has been seen is returned.
+template <typename T = float>
+class P2Quantile {
+private:
+  T p;
+  T q[5];       // marker heights
+  int32_t n[5]; // marker positions
+  T np[5];      // desired positions
+  T dn[5];      // desired position increments
+  uint32_t count;
+
+  T parabolic(uint8_t i, int8_t d) const {
+    return q[i] + (T)d / (n[i + 1] - n[i - 1]) *
+           ((n[i] - n[i - 1] + d) * (q[i + 1] - q[i]) / (n[i + 1] - n[i]) +
+            (n[i + 1] - n[i] - d) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]));
+  }
+
+  T linear(uint8_t i, int8_t d) const {
+    return q[i] + d * (q[i + d] - q[i]) / (n[i + d] - n[i]);
+  }
+
+  static void sort(T *v, uint8_t len) {
+    for (uint8_t i = 1; i < len; i++) {
+      T x = v[i];
+      int8_t j = i - 1;
+      while (j >= 0 && v[j] > x) {
+        v[j + 1] = v[j];
+        j--;
+      }
+      v[j + 1] = x;
+    }
+  }
+
+public:
+  P2Quantile(T quantile = (T)0.5) : p(quantile) { reset(); }
+
+  void reset() {
+    count = 0;
+    dn[0] = 0;
+    dn[1] = p / 2;
+    dn[2] = p;
+    dn[3] = (1 + p) / 2;
+    dn[4] = 1;
+  }
+
+  void add(T x) {
+    if (count < 5) {
+      q[count++] = x;
+      if (count == 5) {
+        sort(q, 5);
+        for (uint8_t i = 0; i < 5; i++) {
+          n[i] = i;
+          np[i] = 4 * dn[i];
+        }
+      }
+      return;
+    }
+    count++;
+
+    uint8_t k;
+    if (x < q[0]) {
+      q[0] = x;
+      k = 0;
+    } else if (x >= q[4]) {
+      q[4] = x;
+      k = 3;
+    } else {
+      for (k = 0; k < 3 && x >= q[k + 1]; k++) {}
+    }
+    for (uint8_t i = k + 1; i < 5; i++) n[i]++;
+    for (uint8_t i = 0; i < 5; i++) np[i] += dn[i];
+
+    for (uint8_t i = 1; i < 4; i++) {
+      T d = np[i] - n[i];
+      if ((d >= 1 && n[i + 1] - n[i] > 1) || (d <= -1 && n[i - 1] - n[i] < -1)) {
+        int8_t s = d > 0 ? 1 : -1;
+        T h = parabolic(i, s);
+        q[i] = (q[i - 1] < h && h < q[i + 1]) ? h : linear(i, s);
+        n[i] += s;
+      }
+    }
+  }
+
+  T value() const {
+    if (count == 0) return (T)NAN;
+    if (count >= 5) return q[2];  // the middle marker tracks p
+    T v[5];
+    memcpy(v, q, count * sizeof(T));
+    sort(v, count);
+    return v[(uint8_t)(p * (count - 1) + (T)0.5)];
+  }
+
+  uint32_t getCount() const { return count; }
+};
+
+// Smoothed rate of change per second from timestamped samples.
+template <typename T = float>
+class RateOfChange {
+private:
+  Ewma<T> rate;
+  T last;
+  uint32_t lastMs;
+  bool primed;
+
+public:
+  RateOfChange(T alpha) : rate(alpha), primed(false) {}
+
+  void reset() {
+    rate.reset();
+    primed = false;
+  }
+
+  void add(uint32_t ms, T x) {
+    if (primed && ms != lastMs) {
+      rate.add((x - last) * 1000 / (T)(ms - lastMs));
+    }
+    last = x;
+    lastMs = ms;
+    primed = true;
+  }
+
+  // Units per second, NAN until two samples have been seen.
+  T perSecond() const { return rate.mean(); }
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef SYSTEM_STATE_H
+#define SYSTEM_STATE_H
+
+#include <Arduino.h>
+#include "ZoneTable.h"
+
+// Everything the display and console show, copied out of the controllers
+// in one piece. The control side publishes it through a Seqlock; readers
+// only ever see a complete snapshot.
+struct SystemState {
+  uint32_t publishedAt;              // millis()
+  uint32_t epoch;                    // RTCManager::getEpoch()
+
+  // climate
+  float temperature;
+  float humidity;
+  uint16_t climateUpdates;
+  uint8_t climateFaults;             // SensorFault bits, temperature | humidity
+  bool climateDegraded;
+
+  // zones
+  uint8_t zoneCount;
+  uint16_t soilGeneration;
+  uint16_t valid;
+  uint16_t uncalibrated;
+  uint16_t pumping;
+  uint16_t waiting;
+  uint16_t dosing;
+  uint16_t degraded;
+  uint8_t faults[MAX_ZONES];
+  uint16_t millivolts[MAX_ZONES];
+  uint16_t noiseMv[MAX_ZONES];
+  int16_t moisture[MAX_ZONES];       // 0.1 %
+  int16_t threshold[MAX_ZONES];      // 0.1 %
+  int16_t dayMin[MAX_ZONES];         // 0.1 %, last 24 h
+  int16_t dayMax[MAX_ZONES];
+  uint16_t daySamples[MAX_ZONES];
+  uint8_t waterCount[MAX_ZONES];
+  uint8_t maxPerWeek[MAX_ZONES];
+
+  // power
+  uint16_t usedMa;
+  uint16_t budgetMa;
+  uint8_t queueLength;
+
+  bool isValid(uint8_t z) const { return valid & ZoneState::bit(z); }
+  bool isUncalibrated(uint8_t z) const { return uncalibrated & ZoneState::bit(z); }
+  bool isPumping(uint8_t z) const { return pumping & ZoneState::bit(z); }
+  bool isWaiting(uint8_t z) const { return waiting & ZoneState::bit(z); }
+  bool isDosing(uint8_t z) const { return dosing & ZoneState::bit(z); }
+  bool isDegraded(uint8_t z) const { return degraded & ZoneState::bit(z); }
+  float moisturePct(uint8_t z) const { return isValid(z) ? moisture[z] * 0.1f : NAN; }
+};
+
+#endif
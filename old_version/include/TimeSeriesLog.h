@@ -0,0 +1,329 @@
+#ifndef TIME_SERIES_LOG_H
+#define TIME_SERIES_LOG_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <esp_partition.h>
+#include <freertos/semphr.h>
+
+#define TSLOG_PAGE_SIZE     4096          // one flash erase block
+#define TSLOG_PARTITION     "tslog"
+#define TSLOG_MAGIC         0x54534C31UL  // "TSL1"
+#define TSLOG_MAX_SERIES    32
+#define TSLOG_CHECKPOINT_S  600           // partial page to flash at least this often
+
+// Series ids shared by every writer and reader of the log.
+#define SERIES_TEMPERATURE  0             // 0.1 degC
+#define SERIES_HUMIDITY     1             // 0.1 %RH
+#define SERIES_MOISTURE(z)  (2 + (z))     // 0.1 %, zones 0..15
+#define SERIES_WATERING     18            // (zone << 16) | ml
+
+// Append-only sensor history in a raw flash partition.
+//
+// Samples taken at the same instant form a frame:
+//   zigzag varint  delta-of-delta of the frame time (seconds)
+//   varint         bitmask of the series present
+//   zigzag varint  value - previous value, per series present
+// Frames are batched in a RAM page. append() never touches flash: a full
+// page is handed to the writer task (runWriter(), low priority) and
+// appending carries on in a second RAM page, so the sector erase and
+// program happen off the caller's task. Every TSLOG_CHECKPOINT_S the
+// partial page is copied to a third buffer and written to its slot too, so
+// a reset loses at most that much; the finished page later overwrites the
+// checkpoint. Pages form a ring over the partition so every sector is
+// erased once per lap plus once per checkpoint (wear levelling). The
+// newest page is found at boot from the header sequence numbers. Each
+// page decodes on its own, so losing one never corrupts the others.
+class TimeSeriesLog {
+public:
+  struct PageHeader {
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t baseTime;   // time of the first frame
+    uint32_t lastTime;   // time of the last frame
+    uint16_t used;       // payload bytes
+    uint16_t frames;
+  };
+
+  static const uint16_t PAYLOAD_SIZE = TSLOG_PAGE_SIZE - sizeof(PageHeader);
+
+private:
+  struct Encoder {
+    uint32_t prevTime;
+    int32_t prevDelta;
+    int32_t prevValue[TSLOG_MAX_SERIES];
+  };
+
+  struct Page {
+    PageHeader header;
+    uint8_t payload[PAYLOAD_SIZE];
+  };
+
+  const esp_partition_t *partition;
+  uint16_t pageCount;
+  std::atomic<uint16_t> head;   // flash slot of the next page, writer only
+  uint32_t sequence;            // of the page being filled
+  std::atomic<uint32_t> pagesWritten;
+  std::atomic<uint32_t> writeErrors;
+  uint32_t dropped;             // frames lost while the writer was behind
+  uint32_t checkpointAt;
+
+  // The appending task fills a buffer and publishes it with a release
+  // store of its flag; the writer hands it back the same way.
+  Page pages[2];
+  uint8_t fill;                 // page append() writes to
+  std::atomic<bool> pageQueued; // the other one is full, for the writer
+  Page snapshot;
+  std::atomic<bool> snapshotQueued;
+  SemaphoreHandle_t queued;
+  Encoder enc;
+
+  Page &current() { return pages[fill]; }
+  const Page &current() const { return pages[fill]; }
+
+  static uint8_t putVarint(uint8_t *out, uint32_t v) {
+    uint8_t n = 0;
+    while (v >= 0x80) {
+      out[n++] = (uint8_t)(v | 0x80);
+      v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+  }
+
+  static bool getVarint(const uint8_t *in, uint16_t len, uint16_t &pos, uint32_t &v) {
+    v = 0;
+    for (uint8_t shift = 0; shift < 35 && pos < len; shift += 7) {
+      uint8_t b = in[pos++];
+      v |= (uint32_t)(b & 0x7F) << shift;
+      if (!(b & 0x80)) return true;
+    }
+    return false;
+  }
+
+  static uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+  static int32_t unzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+  void resetPage(uint32_t t) {
+    PageHeader &header = current().header;
+    memset(&header, 0, sizeof(header));
+    header.magic = TSLOG_MAGIC;
+    header.sequence = sequence;
+    header.baseTime = t;
+    memset(&enc, 0, sizeof(enc));
+    enc.prevTime = t;
+    checkpointAt = t;
+  }
+
+  uint8_t encodeFrame(uint8_t *out, uint32_t t, uint32_t mask, const int32_t *values) const {
+    int32_t delta = (int32_t)(t - enc.prevTime);
+    uint8_t n = putVarint(out, zigzag(delta - enc.prevDelta));
+    n += putVarint(out + n, mask);
+    for (uint8_t s = 0; s < TSLOG_MAX_SERIES; s++) {
+      if (mask & (1UL << s)) n += putVarint(out + n, zigzag(values[s] - enc.prevValue[s]));
+    }
+    return n;
+  }
+
+  void commitFrame(uint32_t t, uint32_t mask, const int32_t *values) {
+    enc.prevDelta = (int32_t)(t - enc.prevTime);
+    enc.prevTime = t;
+    for (uint8_t s = 0; s < TSLOG_MAX_SERIES; s++) {
+      if (mask & (1UL << s)) enc.prevValue[s] = values[s];
+    }
+    current().header.lastTime = t;
+    current().header.frames++;
+  }
+
+  uint32_t pageAddress(uint16_t page) const { return (uint32_t)page * TSLOG_PAGE_SIZE; }
+
+  // Payload goes first and the header last, so a page torn by a reset is
+  // never seen as valid.
+  bool writePage(uint16_t slot, const Page &p) {
+    uint32_t addr = pageAddress(slot);
+    return esp_partition_erase_range(partition, addr, TSLOG_PAGE_SIZE) == ESP_OK &&
+           esp_partition_write(partition, addr + sizeof(PageHeader), p.payload, p.header.used) == ESP_OK &&
+           esp_partition_write(partition, addr, &p.header, sizeof(p.header)) == ESP_OK;
+  }
+
+  // Hands the current page to the writer and starts the next one. False
+  // when the writer has not written the previous page yet.
+  bool closePage() {
+    if (pageQueued.load(std::memory_order_acquire)) return false;
+    fill ^= 1;
+    pageQueued.store(true, std::memory_order_release);
+    xSemaphoreGive(queued);
+    sequence++;
+    current().header.frames = 0;
+    current().header.used = 0;
+    return true;
+  }
+
+  // Copies the partial page for the writer. Skipped (and retried on the
+  // next frame) while the previous checkpoint is still being written.
+  void checkpoint(uint32_t t) {
+    if (snapshotQueued.load(std::memory_order_acquire)) return;
+    const Page &p = current();
+    snapshot.header = p.header;
+    memcpy(snapshot.payload, p.payload, p.header.used);
+    checkpointAt = t;
+    snapshotQueued.store(true, std::memory_order_release);
+    xSemaphoreGive(queued);
+  }
+
+public:
+  TimeSeriesLog() : partition(nullptr), pageCount(0), head(0), sequence(0),
+                    pagesWritten(0), writeErrors(0), dropped(0), checkpointAt(0),
+                    fill(0), pageQueued(false), snapshotQueued(false), queued(nullptr) {
+    resetPage(0);
+  }
+
+  // Finds the partition and resumes after the newest page on flash.
+  bool begin() {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                         ESP_PARTITION_SUBTYPE_ANY, TSLOG_PARTITION);
+    if (!partition) return false;
+    queued = xSemaphoreCreateBinary();
+    if (!queued) {
+      partition = nullptr;
+      return false;
+    }
+    pageCount = partition->size / TSLOG_PAGE_SIZE;
+
+    bool found = false;
+    uint32_t newest = 0;
+    for (uint16_t p = 0; p < pageCount; p++) {
+      PageHeader h;
+      if (esp_partition_read(partition, pageAddress(p), &h, sizeof(h)) != ESP_OK) continue;
+      if (h.magic != TSLOG_MAGIC) continue;
+      if (!found || (int32_t)(h.sequence - newest) > 0) {
+        newest = h.sequence;
+        head = (p + 1) % pageCount;
+        found = true;
+      }
+    }
+    sequence = found ? newest + 1 : 0;
+    resetPage(0);
+    return true;
+  }
+
+  // Writer task body: writes each page handed over by append() or flush(),
+  // then any checkpoint; a checkpoint of the page just written is stale
+  // and skipped. Never returns; run it at low priority.
+  void runWriter() {
+    for (;;) {
+      xSemaphoreTake(queued, portMAX_DELAY);
+      bool wrote = false;
+      uint32_t wroteSequence = 0;
+      if (pageQueued.load(std::memory_order_acquire)) {
+        const Page &p = pages[fill ^ 1];
+        uint16_t slot = head.load(std::memory_order_relaxed);
+        if (!writePage(slot, p)) writeErrors.fetch_add(1, std::memory_order_relaxed);
+        head.store((slot + 1) % pageCount, std::memory_order_relaxed);
+        pagesWritten.fetch_add(1, std::memory_order_relaxed);
+        wrote = true;
+        wroteSequence = p.header.sequence;
+        pageQueued.store(false, std::memory_order_release);
+      }
+      if (snapshotQueued.load(std::memory_order_acquire)) {
+        if (!(wrote && snapshot.header.sequence == wroteSequence) &&
+            !writePage(head.load(std::memory_order_relaxed), snapshot)) {
+          writeErrors.fetch_add(1, std::memory_order_relaxed);
+        }
+        snapshotQueued.store(false, std::memory_order_release);
+      }
+    }
+  }
+
+  // Appends one frame; values[s] is read for every bit s set in mask. Only
+  // copies into RAM. When the page is full and the writer has not taken
+  // the previous one yet, the frame is dropped and counted.
+  void append(uint32_t t, uint32_t mask, const int32_t *values) {
+    if (current().header.frames == 0) resetPage(t);
+
+    uint8_t frame[10 + TSLOG_MAX_SERIES * 5];
+    uint8_t n = encodeFrame(frame, t, mask, values);
+    if (current().header.used + n > PAYLOAD_SIZE) {
+      if (!closePage()) {
+        dropped++;
+        return;
+      }
+      resetPage(t);
+      n = encodeFrame(frame, t, mask, values);
+    }
+    Page &p = current();
+    memcpy(p.payload + p.header.used, frame, n);
+    p.header.used += n;
+    commitFrame(t, mask, values);
+
+    if (t - checkpointAt >= TSLOG_CHECKPOINT_S) checkpoint(t);
+  }
+
+  // Closes the RAM page early and queues it for the writer.
+  bool flush() {
+    if (!partition || current().header.frames == 0) return false;
+    return closePage();
+  }
+
+  // Calls fn(time, series, value) for every sample with from <= time <= to,
+  // oldest page first, including the pages still in RAM. Call it from the
+  // task that appends. Checkpoints on flash of a page still in RAM are
+  // skipped in favour of the RAM copy.
+  template <typename F>
+  void scan(uint32_t from, uint32_t to, F fn) const {
+    const Page &queuedPage = pages[fill ^ 1];
+    bool waiting = pageQueued.load(std::memory_order_acquire);
+    const PageHeader &header = current().header;
+    if (partition) {
+      uint16_t start = head.load(std::memory_order_relaxed);
+      for (uint16_t i = 0; i < pageCount; i++) {
+        uint16_t p = (start + i) % pageCount;
+        PageHeader h;
+        if (esp_partition_read(partition, pageAddress(p), &h, sizeof(h)) != ESP_OK) continue;
+        if (h.magic != TSLOG_MAGIC || h.used > PAYLOAD_SIZE) continue;
+        if (header.frames > 0 && h.sequence == header.sequence) continue;
+        if (waiting && h.sequence == queuedPage.header.sequence) continue;
+        if ((int32_t)(h.lastTime - from) < 0 || (int32_t)(h.baseTime - to) > 0) continue;
+
+        static uint8_t buf[PAYLOAD_SIZE];
+        if (esp_partition_read(partition, pageAddress(p) + sizeof(h), buf, h.used) != ESP_OK) continue;
+        decodePage(h, buf, from, to, fn);
+      }
+    }
+    if (waiting) decodePage(queuedPage.header, queuedPage.payload, from, to, fn);
+    if (header.frames > 0) decodePage(header, current().payload, from, to, fn);
+  }
+
+  template <typename F>
+  static void decodePage(const PageHeader &h, const uint8_t *data,
+                         uint32_t from, uint32_t to, F fn) {
+    int32_t prev[TSLOG_MAX_SERIES] = {0};
+    uint32_t t = h.baseTime;
+    int32_t delta = 0;
+    uint16_t pos = 0;
+
+    for (uint16_t f = 0; f < h.frames; f++) {
+      uint32_t v, mask;
+      if (!getVarint(data, h.used, pos, v)) return;
+      delta += unzigzag(v);
+      t += delta;
+      if (!getVarint(data, h.used, pos, mask)) return;
+      for (uint8_t s = 0; s < TSLOG_MAX_SERIES; s++) {
+        if (!(mask & (1UL << s))) continue;
+        if (!getVarint(data, h.used, pos, v)) return;
+        prev[s] += unzigzag(v);
+        if ((int32_t)(t - from) >= 0 && (int32_t)(t - to) <= 0) fn(t, s, prev[s]);
+      }
+    }
+  }
+
+  bool isReady() const { return partition != nullptr; }
+  uint16_t getPageCount() const { return pageCount; }
+  uint32_t getPagesWritten() const { return pagesWritten.load(std::memory_order_relaxed); }
+  uint32_t getWriteErrors() const { return writeErrors.load(std::memory_order_relaxed); }
+  uint32_t getDropped() const { return dropped; }
+  uint16_t getBufferedBytes() const { return current().header.used; }
+  uint16_t getBufferedFrames() const { return current().header.frames; }
+};
+
+#endif
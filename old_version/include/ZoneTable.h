@@ -0,0 +1,107 @@
+#ifndef ZONE_TABLE_H
+#define ZONE_TABLE_H
+
+#include <Arduino.h>
+
+#define MAX_ZONES   16
+#define ZONE_DIRECT 0xFF   // probe wired straight to an ADC pin, no mux
+
+// Dosing defaults until a zone is calibrated ("dose" console command).
+#define DOSE_DEFAULT_FLOW_ML_MIN 100
+#define DOSE_DEFAULT_ML          35
+#define DOSE_DEFAULT_PULSE_ML    15
+#define DOSE_DEFAULT_SOAK_S      60
+#define DOSE_DEFAULT_TARGET_GAIN 100   // 0.1 %: stop early 10 % above threshold
+
+// One row of the board's zone table. Probes behind a 16:1 analog mux
+// (CD74HC4067) share an ADC pin and differ only in muxChannel.
+struct ZoneConfig {
+  uint8_t adcPin;
+  uint8_t muxChannel;
+  uint8_t pump;            // index in the board's pump list
+  uint16_t pumpMa;         // pump draw, for the power scheduler
+  uint8_t thresholdPct;
+  uint8_t maxPerWeek;
+};
+
+// Runtime state for every zone, laid out as structure-of-arrays so the
+// per-tick passes walk small contiguous arrays. Per-zone flags are packed
+// one bit per zone.
+struct ZoneState {
+  uint8_t count;
+
+  uint8_t adcPin[MAX_ZONES];
+  uint8_t muxChannel[MAX_ZONES];
+  uint8_t pump[MAX_ZONES];
+  uint16_t pumpMa[MAX_ZONES];
+
+  // sensing
+  uint16_t millivolts[MAX_ZONES];    // median of the reading window
+  uint16_t noiseMv[MAX_ZONES];       // standard deviation within the window
+  int16_t moisture[MAX_ZONES];       // 0.1 %
+  uint16_t valid;                    // moisture[z] holds a reading
+  uint16_t uncalibrated;             // no usable calibration, millivolts only
+  uint32_t readingAt[MAX_ZONES];     // millis() of the last published reading
+  uint32_t nextCheck[MAX_ZONES];     // millis() the zone is next sampled
+  uint8_t faults[MAX_ZONES];         // SensorFault bits of the latest reading
+  uint16_t degraded;                 // probe failed its checks repeatedly
+
+  // watering
+  int16_t threshold[MAX_ZONES];      // 0.1 %
+  uint8_t maxPerWeek[MAX_ZONES];
+  uint8_t waterCount[MAX_ZONES];     // this week
+  uint32_t pumpStart[MAX_ZONES];     // millis() of the last pump start
+  uint16_t pumping;
+  uint16_t waiting;                  // queued behind the power budget
+  uint16_t watered;                  // pumped at least once since boot
+
+  // dosing: a watering cycle is doseMl split into pulses with soaks between
+  uint16_t flowMlPerMin[MAX_ZONES];  // pump calibration
+  uint16_t doseMl[MAX_ZONES];
+  uint16_t pulseMl[MAX_ZONES];
+  uint16_t soakSec[MAX_ZONES];
+  int16_t target[MAX_ZONES];         // 0.1 %, adaptive early stop
+  uint16_t dosedMl[MAX_ZONES];       // delivered in the current cycle
+  uint16_t inFlightMl[MAX_ZONES];    // volume of the queued/running pulse
+  uint16_t dosing;                   // a dose cycle is in progress
+  uint16_t adaptive;                 // stop once target is reached
+
+  void init(const ZoneConfig *config, uint8_t n) {
+    memset(this, 0, sizeof(*this));
+    count = n > MAX_ZONES ? MAX_ZONES : n;
+    for (uint8_t z = 0; z < count; z++) {
+      adcPin[z]     = config[z].adcPin;
+      muxChannel[z] = config[z].muxChannel;
+      pump[z]       = config[z].pump;
+      pumpMa[z]     = config[z].pumpMa;
+      threshold[z]  = config[z].thresholdPct * 10;
+      maxPerWeek[z] = config[z].maxPerWeek;
+
+      flowMlPerMin[z] = DOSE_DEFAULT_FLOW_ML_MIN;
+      doseMl[z]       = DOSE_DEFAULT_ML;
+      pulseMl[z]      = DOSE_DEFAULT_PULSE_ML;
+      soakSec[z]      = DOSE_DEFAULT_SOAK_S;
+      target[z]       = threshold[z] + DOSE_DEFAULT_TARGET_GAIN;
+      adaptive       |= bit(z);
+    }
+  }
+
+  static uint16_t bit(uint8_t z) { return (uint16_t)1u << z; }
+  bool isValid(uint8_t z) const { return valid & bit(z); }
+  bool isUncalibrated(uint8_t z) const { return uncalibrated & bit(z); }
+  bool isPumping(uint8_t z) const { return pumping & bit(z); }
+  bool isWaiting(uint8_t z) const { return waiting & bit(z); }
+  bool isDosing(uint8_t z) const { return dosing & bit(z); }
+  // The reading is not to be acted on.
+  bool isSuspect(uint8_t z) const { return faults[z] != 0; }
+
+  uint32_t mlToMs(uint8_t z, uint16_t ml) const {
+    return (uint32_t)ml * 60000UL / (flowMlPerMin[z] ? flowMlPerMin[z] : 1);
+  }
+
+  float moisturePct(uint8_t z) const {
+    return isValid(z) ? moisture[z] * 0.1f : NAN;
+  }
+};
+
+#endif
@@ -1,4 +1,6 @@
 #include "Adafruit_Sensor.h"
+#include <math.h>
+#include <string.h>
 
 /**************************************************************************/
 /*!
@@ -118,3 +120,197 @@ void Adafruit_Sensor::printSensorDetails(void) {
   Serial.println(sensor.resolution);
   Serial.println(F("------------------------------------\n"));
 }
+
+/**************************************************************************/
+/*!
+    @brief  Packs a scalar event into 8 bytes. The round trip through
+            sensorsUnpack() is exact for any value read as a number with at
+            most four decimals (every 0.1 or 1/16 step) up to 1677 units,
+            and for NAN.
+    @param  event
+            event to pack
+    @param  delta_ms
+            time since the previous event of the stream
+    @param  packed
+            result
+    @returns false for vector and colour events, sensor ids outside
+             -128..127 and values beyond the fixed-point range
+*/
+/**************************************************************************/
+bool sensorsPack(const sensors_event_t *event, uint16_t delta_ms,
+                 sensors_packed_event_t *packed) {
+  switch (event->type) {
+  case SENSOR_TYPE_ACCELEROMETER:
+  case SENSOR_TYPE_MAGNETIC_FIELD:
+  case SENSOR_TYPE_ORIENTATION:
+  case SENSOR_TYPE_GYROSCOPE:
+  case SENSOR_TYPE_GRAVITY:
+  case SENSOR_TYPE_LINEAR_ACCELERATION:
+  case SENSOR_TYPE_ROTATION_VECTOR:
+  case SENSOR_TYPE_COLOR:
+    return false;
+  }
+  if (event->type <= 0 || event->type >= SENSORS_PACKED_TIMEBASE ||
+      event->sensor_id < INT8_MIN || event->sensor_id > INT8_MAX)
+    return false;
+
+  float v = event->data[0];
+  int32_t value = SENSORS_PACKED_NAN;
+  if (!isnan(v)) {
+    if (event->type != SENSOR_TYPE_GAS_RESISTANCE)
+      v *= SENSORS_PACKED_SCALE;
+    if (!(fabsf(v) < 2147483520.0f)) // largest float below 2^31
+      return false;
+    value = lroundf(v);
+  }
+
+  packed->sensor_id = event->sensor_id;
+  packed->type = event->type;
+  packed->delta_ms = delta_ms;
+  packed->value = value;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Expands a packed event
+    @param  packed
+            packed event (not a timebase marker)
+    @param  timestamp
+            absolute time of the event, see Adafruit_SensorRing::readTime()
+    @param  event
+            result
+*/
+/**************************************************************************/
+void sensorsUnpack(const sensors_packed_event_t *packed, int32_t timestamp,
+                   sensors_event_t *event) {
+  memset(event, 0, sizeof(sensors_event_t));
+  event->version = sizeof(sensors_event_t);
+  event->sensor_id = packed->sensor_id;
+  event->type = packed->type;
+  event->timestamp = timestamp;
+  if (packed->value == SENSORS_PACKED_NAN)
+    event->data[0] = NAN;
+  else if (packed->type == SENSOR_TYPE_GAS_RESISTANCE)
+    event->data[0] = packed->value;
+  else
+    event->data[0] = packed->value / (float)SENSORS_PACKED_SCALE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Creates a ring over caller-provided storage
+    @param  buffer
+            storage for capacity events
+    @param  capacity
+            number of events
+*/
+/**************************************************************************/
+Adafruit_SensorRing::Adafruit_SensorRing(sensors_packed_event_t *buffer,
+                                         uint16_t capacity)
+    : _buffer(buffer), _capacity(capacity), _dropped(0) {
+  clear();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Empties the ring; the next push starts with a timebase marker
+*/
+/**************************************************************************/
+void Adafruit_SensorRing::clear() {
+  _head = _tail = _count = 0;
+  _writeTime = _readTime = 0;
+  _timebase = false;
+}
+
+void Adafruit_SensorRing::put(const sensors_packed_event_t &packed) {
+  _buffer[_head] = packed;
+  _head = _head + 1 == _capacity ? 0 : _head + 1;
+  _count++;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Packs and appends an event, preceded by a timebase marker when
+            its delta does not fit 16 bits (or runs backwards)
+    @param  event
+            event to append
+    @returns false if the ring is full or the event cannot be packed
+*/
+/**************************************************************************/
+bool Adafruit_SensorRing::push(const sensors_event_t *event) {
+  uint32_t delta = (uint32_t)event->timestamp - (uint32_t)_writeTime;
+  bool marker = !_timebase || delta > UINT16_MAX;
+  sensors_packed_event_t packed;
+  if (_count + (marker ? 2 : 1) > _capacity ||
+      !sensorsPack(event, marker ? 0 : delta, &packed)) {
+    _dropped++;
+    return false;
+  }
+  if (marker) {
+    sensors_packed_event_t base = {0, SENSORS_PACKED_TIMEBASE, 0,
+                                   event->timestamp};
+    put(base);
+    _timebase = true;
+  }
+  put(packed);
+  _writeTime = event->timestamp;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Oldest events, in place. Markers are included; walk them with
+            readTime() or let consume() do it.
+    @param  events
+            set to the first event
+    @returns number of contiguous events from there (the rest follows at
+             the start of the buffer after consume())
+*/
+/**************************************************************************/
+uint16_t Adafruit_SensorRing::peek(const sensors_packed_event_t **events) const {
+  *events = _buffer + _tail;
+  uint16_t run = _capacity - _tail;
+  return _count < run ? _count : run;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Releases events read through peek(), advancing readTime()
+    @param  count
+            number of events
+*/
+/**************************************************************************/
+void Adafruit_SensorRing::consume(uint16_t count) {
+  if (count > _count)
+    count = _count;
+  while (count--) {
+    const sensors_packed_event_t &p = _buffer[_tail];
+    if (p.type == SENSORS_PACKED_TIMEBASE)
+      _readTime = p.value;
+    else
+      _readTime = (int32_t)((uint32_t)_readTime + p.delta_ms);
+    _tail = _tail + 1 == _capacity ? 0 : _tail + 1;
+    _count--;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Takes the oldest event, unpacked, skipping timebase markers
+    @param  event
+            result
+    @returns false if there was none
+*/
+/**************************************************************************/
+bool Adafruit_SensorRing::pop(sensors_event_t *event) {
+  while (_count) {
+    sensors_packed_event_t p = _buffer[_tail];
+    consume(1);
+    if (p.type != SENSORS_PACKED_TIMEBASE) {
+      sensorsUnpack(&p, _readTime, event);
+      return true;
+    }
+  }
+  return false;
+}
@@ -177,6 +177,67 @@ typedef struct {
   };                ///< Union for the wide ranges of data we can carry
 } sensors_event_t;
 
+/* Packed sensor event (8 bytes) */
+/** struct sensors_packed_event_s is a compact form of a scalar
+ * sensors_event_t for logging, batching and forwarding. Timestamps are
+ * deltas to the previous event of the same stream; a timebase marker
+ * (type SENSORS_PACKED_TIMEBASE) carries an absolute timestamp in value
+ * whenever a delta would not fit. */
+typedef struct {
+  int8_t sensor_id;  /**< sensor identifier, -128..127 */
+  uint8_t type;      /**< sensors_type_t, or SENSORS_PACKED_TIMEBASE */
+  uint16_t delta_ms; /**< milliseconds since the previous event */
+  int32_t value; /**< value * SENSORS_PACKED_SCALE (gas resistance: ohms), or
+                    SENSORS_PACKED_NAN; a marker's absolute timestamp */
+} sensors_packed_event_t;
+
+#define SENSORS_PACKED_TIMEBASE (0xFF) /**< Marker event type */
+#define SENSORS_PACKED_SCALE                                                   \
+  (10000) /**< Fixed point: four decimals, exact for 0.1 and 1/16 steps */
+#define SENSORS_PACKED_NAN (INT32_MIN) /**< A reading that failed */
+
+bool sensorsPack(const sensors_event_t *event, uint16_t delta_ms,
+                 sensors_packed_event_t *packed);
+void sensorsUnpack(const sensors_packed_event_t *packed, int32_t timestamp,
+                   sensors_event_t *event);
+
+/** @brief Ring of packed events. Producers push sensors_event_t and the ring
+ * inserts timebase markers as needed; consumers either
+ * read runs of packed events in place with peek()/consume() or unpack one
+ * at a time with pop(). The caller provides the storage. Not synchronised:
+ * use it from one task, or guard it.
+ */
+class Adafruit_SensorRing {
+public:
+  Adafruit_SensorRing(sensors_packed_event_t *buffer, uint16_t capacity);
+
+  bool push(const sensors_event_t *event);
+  uint16_t peek(const sensors_packed_event_t **events) const;
+  void consume(uint16_t count);
+  bool pop(sensors_event_t *event);
+  void clear();
+
+  /*! @brief Events (markers included) waiting to be read
+      @returns count */
+  uint16_t available() const { return _count; }
+  /*! @brief Timestamp the next event's delta is relative to
+      @returns milliseconds */
+  int32_t readTime() const { return _readTime; }
+  /*! @brief Events rejected because the ring was full or the event could
+      not be packed
+      @returns count */
+  uint32_t dropped() const { return _dropped; }
+
+private:
+  sensors_packed_event_t *_buffer;
+  uint16_t _capacity, _head, _tail, _count;
+  int32_t _writeTime, _readTime;
+  bool _timebase; // a marker has been written since clear()
+  uint32_t _dropped;
+
+  void put(const sensors_packed_event_t &packed);
+};
+
 /* Sensor details (40 bytes) */
 /** struct sensor_s is used to describe basic information about a specific
  * sensor. */
@@ -218,6 +279,15 @@ public:
   /*! @brief Get info about the sensor itself */
   virtual void getSensor(sensor_t *) = 0;
 
+  /*! @brief Append the latest events to a ring. Sensors that produce
+      several values per read override this to deliver them together.
+      @param ring destination
+      @returns number of events added */
+  virtual uint16_t getEvents(Adafruit_SensorRing *ring) {
+    sensors_event_t event;
+    return getEvent(&event) && ring->push(&event) ? 1 : 0;
+  }
+
   void printSensorDetails(void);
 };
 
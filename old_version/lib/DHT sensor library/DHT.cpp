@@ -27,9 +27,18 @@
 
 #define MIN_INTERVAL 2000 /**< min interval value */
 #define TIMEOUT                                                                \
-  UINT32_MAX /**< Used programmatically for timeout.                           \
+  DHT_PULSE_TIMEOUT /**< Used programmatically for timeout.                    \
                    Not a timeout duration. Type: uint32_t. */
 
+#ifdef DHT_USE_RMT
+#ifndef DHT_RMT_LAST_CHANNEL
+#define DHT_RMT_LAST_CHANNEL 7 /**< Sensors take channel pairs from here down */
+#endif
+#define DHT_RMT_CAPTURE_MS 100 /**< Give up on a capture after this long */
+#define DHT_RMT_TICKS_PER_US 1 /**< RX channel clock, see clk_div */
+static int8_t rmtNextChannel = DHT_RMT_LAST_CHANNEL;
+#endif
+
 /*!
  *  @brief  Instantiates a new DHT class
  *  @param  pin
@@ -50,6 +59,15 @@ DHT::DHT(uint8_t pin, uint8_t type, uint8_t count) {
   _maxcycles =
       microsecondsToClockCycles(1000); // 1 millisecond timeout for
                                        // reading pulses from DHT sensor.
+  _ticksPerUs = 0;
+  _retry = 0;
+  _lastStatus = DHT_DECODE_OK;
+  resetStats();
+#ifdef DHT_USE_RMT
+  _rmtReady = false;
+  _rmtPending = false;
+  _rmtRing = nullptr;
+#endif
   // Note that count is now ignored as the DHT reading algorithm adjusts itself
   // based on the speed of the processor.
 }
@@ -70,6 +88,9 @@ void DHT::begin(uint8_t usec) {
   DEBUG_PRINT("DHT max clock cycles: ");
   DEBUG_PRINTLN(_maxcycles, DEC);
   pullTime = usec;
+#ifdef DHT_USE_RMT
+  _rmtReady = rmtBegin();
+#endif
 }
 
 /*!
@@ -129,7 +150,7 @@ float DHT::readTemperature(bool S, bool force) {
  *					value in Celcius
  *	@return float value in Fahrenheit
  */
-float DHT::convertCtoF(float c) { return c * 1.8 + 32; }
+float DHT::convertCtoF(float c) { return c * 1.8f + 32; }
 
 /*!
  *  @brief  Converts Fahrenheit to Celcius
@@ -137,7 +158,7 @@ float DHT::convertCtoF(float c) { return c * 1.8 + 32; }
  *					value in Fahrenheit
  *	@return float value in Celcius
  */
-float DHT::convertFtoC(float f) { return (f - 32) * 0.55555; }
+float DHT::convertFtoC(float f) { return (f - 32) * 0.55555f; }
 
 /*!
  *  @brief  Read Humidity
@@ -196,26 +217,26 @@ float DHT::computeHeatIndex(float temperature, float percentHumidity,
   if (!isFahrenheit)
     temperature = convertCtoF(temperature);
 
-  hi = 0.5 * (temperature + 61.0 + ((temperature - 68.0) * 1.2) +
-              (percentHumidity * 0.094));
+  // Float throughout: boards without a double FPU emulate every double
+  // operation, and pow() is far slower still.
+  hi = 0.5f * (temperature + 61.0f + ((temperature - 68.0f) * 1.2f) +
+               (percentHumidity * 0.094f));
 
   if (hi > 79) {
-    hi = -42.379 + 2.04901523 * temperature + 10.14333127 * percentHumidity +
-         -0.22475541 * temperature * percentHumidity +
-         -0.00683783 * pow(temperature, 2) +
-         -0.05481717 * pow(percentHumidity, 2) +
-         0.00122874 * pow(temperature, 2) * percentHumidity +
-         0.00085282 * temperature * pow(percentHumidity, 2) +
-         -0.00000199 * pow(temperature, 2) * pow(percentHumidity, 2);
-
-    if ((percentHumidity < 13) && (temperature >= 80.0) &&
-        (temperature <= 112.0))
-      hi -= ((13.0 - percentHumidity) * 0.25) *
-            sqrt((17.0 - abs(temperature - 95.0)) * 0.05882);
-
-    else if ((percentHumidity > 85.0) && (temperature >= 80.0) &&
-             (temperature <= 87.0))
-      hi += ((percentHumidity - 85.0) * 0.1) * ((87.0 - temperature) * 0.2);
+    // Rothfusz regression, the nine terms regrouped in Horner form.
+    float t = temperature, rh = percentHumidity;
+    hi = (-42.379f + t * (2.04901523f + t * -0.00683783f)) +
+         rh * ((10.14333127f + t * (-0.22475541f + t * 0.00122874f)) +
+               rh * (-0.05481717f + t * (0.00085282f + t * -0.00000199f)));
+
+    if ((percentHumidity < 13) && (temperature >= 80.0f) &&
+        (temperature <= 112.0f))
+      hi -= ((13.0f - percentHumidity) * 0.25f) *
+            sqrtf((17.0f - fabsf(temperature - 95.0f)) * 0.05882f);
+
+    else if ((percentHumidity > 85.0f) && (temperature >= 80.0f) &&
+             (temperature <= 87.0f))
+      hi += ((percentHumidity - 85.0f) * 0.1f) * ((87.0f - temperature) * 0.2f);
   }
 
   return isFahrenheit ? hi : convertFtoC(hi);
@@ -229,6 +250,11 @@ float DHT::computeHeatIndex(float temperature, float percentHumidity,
  *	@return float value
  */
 bool DHT::read(bool force) {
+#ifdef DHT_USE_RMT
+  if (_rmtReady)
+    return rmtRead(force);
+#endif
+
   // Check if sensor was read less than two seconds ago and return early
   // to use last reading.
   uint32_t currenttime = millis();
@@ -237,8 +263,45 @@ bool DHT::read(bool force) {
   }
   _lastreadtime = currenttime;
 
-  // Reset 40 bits of received data to zero.
-  data[0] = data[1] = data[2] = data[3] = data[4] = 0;
+  readOnce();
+  scheduleRetry(currenttime);
+  return _lastresult;
+}
+
+/*!
+ *  @brief  Books the outcome of a read. A disturbed frame is usually
+ *          followed by a good one, so after a failure the next read() may
+ *          start after the backoff instead of a full MIN_INTERVAL: pretend
+ *          the last read started that much less than MIN_INTERVAL ago. A
+ *          sensor that does not answer at all is not worth a retry.
+ *  @param  now
+ *          millis() of the read that just finished
+ */
+void DHT::scheduleRetry(uint32_t now) {
+  if (_lastresult) {
+    _retry = 0;
+  } else if (_retry < DHT_READ_RETRIES && _lastStatus != DHT_DECODE_NO_REPLY) {
+    _lastreadtime = now - MIN_INTERVAL + (DHT_RETRY_BACKOFF_MS << _retry);
+    _retry++;
+  } else {
+    _stats.failed++;
+    _retry = 0;
+  }
+}
+
+/*!
+ *  @brief  One bit-banged attempt: start signal, response and 40 bits.
+ *  @return true if a valid frame was received
+ */
+bool DHT::readOnce() {
+  DHTFrame frame;
+
+#ifdef DHT_CYCLE_COUNTER
+  // Pulses are timed in CPU cycles; the clock may have changed since the
+  // last read (dynamic frequency scaling).
+  _ticksPerUs = ESP.getCpuFreqMHz();
+  _maxcycles = 1000 * _ticksPerUs; // 1 millisecond timeout
+#endif
 
 #if defined(ESP8266)
   yield(); // Handle WiFi / reset software watchdog
@@ -282,15 +345,10 @@ bool DHT::read(bool force) {
 
     // First expect a low signal for ~80 microseconds followed by a high signal
     // for ~80 microseconds again.
-    if (expectPulse(LOW) == TIMEOUT) {
-      DEBUG_PRINTLN(F("DHT timeout waiting for start signal low pulse."));
-      _lastresult = false;
-      return _lastresult;
-    }
-    if (expectPulse(HIGH) == TIMEOUT) {
-      DEBUG_PRINTLN(F("DHT timeout waiting for start signal high pulse."));
-      _lastresult = false;
-      return _lastresult;
+    if (expectPulse(LOW) == TIMEOUT || expectPulse(HIGH) == TIMEOUT) {
+      DEBUG_PRINTLN(F("DHT timeout waiting for start signal."));
+      DHTDecoder::decode(cycles, 0, _ticksPerUs, frame);
+      return finishRead(frame);
     }
 
     // Now read the 40 bits sent by the sensor.  Each bit is sent as a 50
@@ -307,25 +365,51 @@ bool DHT::read(bool force) {
     }
   } // Timing critical code is now complete.
 
-  // Inspect pulses and determine which ones are 0 (high state cycle count < low
-  // state cycle count), or 1 (high state cycle count > low state cycle count).
-  for (int i = 0; i < 40; ++i) {
-    uint32_t lowCycles = cycles[2 * i];
-    uint32_t highCycles = cycles[2 * i + 1];
-    if ((lowCycles == TIMEOUT) || (highCycles == TIMEOUT)) {
-      DEBUG_PRINTLN(F("DHT timeout waiting for pulse."));
-      _lastresult = false;
-      return _lastresult;
-    }
-    data[i / 8] <<= 1;
-    // Now compare the low and high cycle times to see if the bit is a 0 or 1.
-    if (highCycles > lowCycles) {
-      // High cycles are greater than 50us low cycle count, must be a 1.
-      data[i / 8] |= 1;
-    }
-    // Else high cycles are less than (or equal to, a weird case) the 50us low
-    // cycle count so this must be a zero.  Nothing needs to be changed in the
-    // stored data.
+  // Decode the pulses. Without a cycle counter they are loop counts with no
+  // fixed unit, which the decoder only compares against each other.
+  DHTDecoder::decode(cycles, 80, _ticksPerUs, frame);
+  return finishRead(frame);
+}
+
+/*!
+ *  @brief  Clears the read-quality counters
+ */
+void DHT::resetStats() { memset(&_stats, 0, sizeof(_stats)); }
+
+/*!
+ *  @brief  Whether a capture is on the wire right now. The CPU must not
+ *          stop (light sleep) then; a finished capture waits in the ring
+ *          buffer and is safe.
+ *  @return true from the start pulse until DHT_RMT_CAPTURE_MS later
+ */
+bool DHT::isCapturing() const {
+#ifdef DHT_USE_RMT
+  return _rmtReady && _rmtPending && millis() - _lastreadtime < DHT_RMT_CAPTURE_MS;
+#else
+  return false; // bit-banged reads finish inside read()
+#endif
+}
+
+/*!
+ *  @brief  Takes over a decoded frame as the current reading.
+ *  @param  frame
+ *          decoder output
+ *  @return true if the frame is complete and its checksum matches
+ */
+bool DHT::finishRead(const DHTFrame &frame) {
+  for (uint8_t i = 0; i < 5; i++)
+    data[i] = frame.data[i];
+
+  _lastStatus = frame.status;
+  _stats.attempts++;
+  if (_retry)
+    _stats.retries++;
+  if (frame.bits == DHT_FRAME_BITS) {
+    uint8_t bucket = frame.minMargin / 10;
+    if (bucket >= DHT_MARGIN_BUCKETS)
+      bucket = DHT_MARGIN_BUCKETS - 1;
+    _stats.margin[bucket]++;
+    _stats.lastMargin = frame.minMargin;
   }
 
   DEBUG_PRINTLN(F("Received from DHT:"));
@@ -341,25 +425,58 @@ bool DHT::read(bool force) {
   DEBUG_PRINT(F(" =? "));
   DEBUG_PRINTLN((data[0] + data[1] + data[2] + data[3]) & 0xFF, HEX);
 
-  // Check we read 40 bits and that the checksum matches.
-  if (data[4] == ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) {
-    _lastresult = true;
-    return _lastresult;
-  } else {
+  switch (frame.status) {
+  case DHT_DECODE_OK:
+    _stats.good++;
+    if (frame.minMargin < DHT_MARGIN_WEAK) {
+      DEBUG_PRINT(F("DHT weak bit "));
+      DEBUG_PRINT(frame.weakestBit);
+      DEBUG_PRINT(F(", margin % "));
+      DEBUG_PRINTLN(frame.minMargin);
+    }
+    break;
+  case DHT_DECODE_CHECKSUM:
+    _stats.checksum++;
     DEBUG_PRINTLN(F("DHT checksum failure!"));
-    _lastresult = false;
-    return _lastresult;
+    break;
+  case DHT_DECODE_TIMEOUT:
+    _stats.timeouts++;
+    DEBUG_PRINTLN(F("DHT timeout waiting for pulse."));
+    break;
+  case DHT_DECODE_NO_REPLY:
+    _stats.noReply++;
+    DEBUG_PRINTLN(F("DHT no reply."));
+    break;
+  default:
+    _stats.truncated++;
+    DEBUG_PRINT(F("DHT short frame, bits: "));
+    DEBUG_PRINTLN(frame.bits);
+    break;
   }
+  _lastresult = frame.status == DHT_DECODE_OK;
+  return _lastresult;
 }
 
 // Expect the signal line to be at the specified level for a period of time and
 // return a count of loop cycles spent at that level (this cycle count can be
-// used to compare the relative time of two pulses).  If more than a millisecond
+// used to compare the relative time of two pulses). With DHT_CYCLE_COUNTER the
+// count is CPU cycles instead, _ticksPerUs per microsecond.  If more than a millisecond
 // ellapses without the level changing then the call fails with a 0 response.
 // This is adapted from Arduino's pulseInLong function (which is only available
 // in the very latest IDE versions):
 //   https://github.com/arduino/Arduino/blob/master/hardware/arduino/avr/cores/arduino/wiring_pulse.c
 uint32_t DHT::expectPulse(bool level) {
+#ifdef DHT_CYCLE_COUNTER
+  // Time the pulse with the cycle counter rather than counting iterations,
+  // so the result is _ticksPerUs per microsecond however slow digitalRead is.
+  uint32_t start = ESP.getCycleCount();
+  while (digitalRead(_pin) == level) {
+    if (ESP.getCycleCount() - start >= _maxcycles) {
+      return TIMEOUT; // Exceeded timeout, fail.
+    }
+  }
+  return ESP.getCycleCount() - start;
+#else
 // F_CPU is not be known at compile time on platforms such as STM32F103.
 // The preprocessor seems to evaluate it to zero in that case.
 #if (F_CPU > 16000000L) || (F_CPU == 0L)
@@ -387,4 +504,118 @@ uint32_t DHT::expectPulse(bool level) {
 #endif
 
   return count;
+#endif
 }
+
+#ifdef DHT_USE_RMT
+/*!
+ *  @brief  Sets up a TX channel for the start pulse and an RX channel for the
+ *          response, both on the sensor pin (open drain, pulled up).
+ *  @return true if both channels were installed
+ */
+bool DHT::rmtBegin() {
+  if (rmtNextChannel < 1)
+    return false; // out of channels, stay on the bit-banged path
+  _rmtRx = (rmt_channel_t)rmtNextChannel;
+  _rmtTx = (rmt_channel_t)(rmtNextChannel - 1);
+
+  // RX first: configuring TX afterwards leaves the input routing in place.
+  rmt_config_t rx = RMT_DEFAULT_CONFIG_RX((gpio_num_t)_pin, _rmtRx);
+  rx.clk_div = 80; // 1 us ticks
+  rx.rx_config.filter_en = true;
+  rx.rx_config.filter_ticks_thresh = 100; // APB ticks; drops glitches < 1.25 us
+  // The capture ends after this long without an edge. It has to outlast our
+  // own start pulse, which the RX channel also sees.
+  rx.rx_config.idle_threshold = (_type == DHT22 || _type == DHT21) ? 2000 : 25000;
+  if (rmt_config(&rx) != ESP_OK || rmt_driver_install(_rmtRx, 512, 0) != ESP_OK)
+    return false;
+
+  rmt_config_t tx = RMT_DEFAULT_CONFIG_TX((gpio_num_t)_pin, _rmtTx);
+  tx.clk_div = 80;
+  tx.tx_config.idle_output_en = true;
+  tx.tx_config.idle_level = RMT_IDLE_LEVEL_HIGH;
+  if (rmt_config(&tx) != ESP_OK || rmt_driver_install(_rmtTx, 0, 0) != ESP_OK) {
+    rmt_driver_uninstall(_rmtRx);
+    return false;
+  }
+
+  // TX left the pad output-only and driven by the RMT. Make it open drain
+  // with the pull-up and turn the input buffer back on for RX, without
+  // touching the routing: gpio_set_direction() would hand the pad back to
+  // the GPIO out register, which holds the bus low.
+  gpio_ll_od_enable(&GPIO, _pin);
+  gpio_ll_input_enable(&GPIO, _pin);
+  gpio_pullup_en((gpio_num_t)_pin);
+  rmt_get_ringbuf_handle(_rmtRx, &_rmtRing);
+  rmtNextChannel -= 2;
+  return _rmtRing != nullptr;
+}
+
+/*!
+ *  @brief  Non-blocking read: collects a finished capture if there is one,
+ *          then starts the next capture once MIN_INTERVAL has passed. Values
+ *          therefore trail the bus by one read interval.
+ *  @param  force
+ *          start a new capture regardless of the interval
+ *  @return true if data[] holds a valid frame
+ */
+bool DHT::rmtRead(bool force) {
+  uint32_t currenttime = millis();
+
+  if (_rmtPending) {
+    size_t length = 0;
+    rmt_item32_t *items =
+        (rmt_item32_t *)xRingbufferReceive(_rmtRing, &length, 0);
+    if (items) {
+      _lastresult = rmtDecode(items, length / sizeof(rmt_item32_t));
+      vRingbufferReturnItem(_rmtRing, items);
+    } else if (currenttime - _lastreadtime < DHT_RMT_CAPTURE_MS) {
+      return _lastresult; // still on the wire
+    } else {
+      DEBUG_PRINTLN(F("DHT timeout waiting for RMT capture."));
+      DHTFrame frame;
+      DHTDecoder::decode(nullptr, 0, DHT_RMT_TICKS_PER_US, frame);
+      _lastresult = finishRead(frame);
+    }
+    rmt_rx_stop(_rmtRx);
+    _rmtPending = false;
+    scheduleRetry(currenttime);
+  }
+
+  if (!force && (currenttime - _lastreadtime) < MIN_INTERVAL)
+    return _lastresult;
+  _lastreadtime = currenttime;
+
+  // Start signal: pull low (at least 1 ms for DHT22, 18 ms for DHT11),
+  // then release. The sensor answers while the RX channel is listening.
+  rmt_item32_t start;
+  start.level0 = 0;
+  start.duration0 = (_type == DHT22 || _type == DHT21) ? 1100 : 20000;
+  start.level1 = 1;
+  start.duration1 = pullTime;
+  rmt_rx_start(_rmtRx, true);
+  rmt_write_items(_rmtTx, &start, 1, false);
+  _rmtPending = true;
+  return _lastresult;
+}
+
+/*!
+ *  @brief  Turns a capture into data[]. The capture starts with our own start
+ *          pulse, then the 80 us low/high response, then 40 low/high bits.
+ *  @param  items
+ *          captured RMT items
+ *  @param  count
+ *          number of items
+ *  @return true if 40 bits arrived and the checksum matches
+ */
+bool DHT::rmtDecode(const rmt_item32_t *items, size_t count) {
+  uint32_t pulses[86];
+  size_t n = DHTDecoder::fromRmt(&items[0].val, count, pulses,
+                                 sizeof(pulses) / sizeof(pulses[0]));
+
+  size_t p = DHTDecoder::skipPreamble(pulses, n, DHT_RMT_TICKS_PER_US);
+  DHTFrame frame;
+  DHTDecoder::decode(pulses + p, n - p, DHT_RMT_TICKS_PER_US, frame);
+  return finishRead(frame);
+}
+#endif
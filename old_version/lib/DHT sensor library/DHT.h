@@ -19,6 +19,37 @@
 #define DHT_H
 
 #include "Arduino.h"
+#include "DHT_Decoder.h"
+
+/* On ESP32 the start pulse and the response are handled by the RMT
+ * peripheral, so a read neither busy-waits nor masks interrupts. Define
+ * DHT_NO_RMT to force the bit-banged path. */
+#if defined(ESP32) && !defined(DHT_NO_RMT)
+#define DHT_USE_RMT
+#include <driver/rmt.h>
+#include <hal/gpio_ll.h>
+#include <freertos/ringbuf.h>
+#endif
+
+/* On ESP32 and ESP8266 pulses are timed with the CPU cycle counter, so the
+ * bit-banged path measures real microseconds whatever the clock (or the
+ * cost of digitalRead). Other platforms count loop iterations. */
+#if defined(ESP32) || defined(ESP8266)
+#define DHT_CYCLE_COUNTER
+#endif
+
+/* Failed reads are retried this many times, DHT_RETRY_BACKOFF_MS, then
+ * twice that, and so on after the failure. read() never waits for a retry:
+ * it only lets the next read() start that early instead of after the full
+ * interval. */
+#ifndef DHT_READ_RETRIES
+#define DHT_READ_RETRIES 2
+#endif
+#ifndef DHT_RETRY_BACKOFF_MS
+#define DHT_RETRY_BACKOFF_MS 10
+#endif
+
+#define DHT_MARGIN_BUCKETS 6 /**< Margin histogram: 10 % wide, last is 50+ */
 
 /* Uncomment to enable printing out nice debug messages. */
 //#define DHT_DEBUG
@@ -57,6 +88,23 @@ static const uint8_t AM2301{21}; /**< AM2301 */
 #endif
 #endif
 
+/*!
+ *  @brief  Read-quality counters of one sensor, per attempt on the wire
+ */
+struct DHTStats {
+  uint32_t attempts;  /**< Frames requested, retries included */
+  uint32_t good;      /**< Frames with a matching checksum */
+  uint32_t retries;   /**< Attempts that were retries */
+  uint32_t failed;    /**< read() calls that failed after all retries */
+  uint32_t noReply;   /**< No response from the sensor */
+  uint32_t timeouts;  /**< A pulse never ended */
+  uint32_t truncated; /**< Fewer than 40 bits */
+  uint32_t checksum;  /**< 40 bits, checksum mismatch */
+  uint32_t margin[DHT_MARGIN_BUCKETS]; /**< Complete frames by their weakest
+                                          bit's margin, 10 % buckets */
+  uint8_t lastMargin; /**< Weakest margin of the last complete frame */
+};
+
 /*!
  *  @brief  Class that stores state and functions for DHT
  */
@@ -73,7 +121,17 @@ public:
   float readHumidity(bool force = false);
   bool read(bool force = false);
 
+  /*!
+   *  @brief  Read-quality counters since begin() or resetStats()
+   *  @return the counters
+   */
+  const DHTStats &getStats() const { return _stats; }
+  void resetStats();
+  bool isCapturing() const;
+
 private:
+  friend class DHTGroup; // feeds frames captured for several sensors at once
+
   uint8_t data[5];
   uint8_t _pin, _type;
 #ifdef __AVR
@@ -86,7 +144,26 @@ private:
   bool _lastresult;
   uint8_t pullTime; // Time (in usec) to pull up data line before reading
 
+  uint32_t _ticksPerUs; // unit of expectPulse(), 0 when loop iterations
+  uint8_t _retry;       // retries spent on the current read
+  DHTDecodeStatus _lastStatus;
+  DHTStats _stats;
+
   uint32_t expectPulse(bool level);
+  bool readOnce();
+  bool finishRead(const DHTFrame &frame);
+  void scheduleRetry(uint32_t now);
+
+#ifdef DHT_USE_RMT
+  bool _rmtReady;   // channels installed; read() uses the RMT path
+  bool _rmtPending; // a capture was started and not collected yet
+  rmt_channel_t _rmtTx, _rmtRx;
+  RingbufHandle_t _rmtRing;
+
+  bool rmtBegin();
+  bool rmtRead(bool force);
+  bool rmtDecode(const rmt_item32_t *items, size_t count);
+#endif
 };
 
 /*!
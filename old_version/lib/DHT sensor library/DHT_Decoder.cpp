@@ -0,0 +1,121 @@
+/*!
+ *  @file DHT_Decoder.cpp
+ *
+ *  Pure DHT frame decoder, see DHT_Decoder.h.
+ *
+ *  MIT license, all text above must be included in any redistribution
+ */
+
+#include "DHT_Decoder.h"
+
+#define PREAMBLE_MIN_US 200 /**< Host start pulse and release are longer */
+#define GLITCH_MAX_US 2     /**< Shorter pulses are noise on the line */
+
+size_t DHTDecoder::skipPreamble(const uint32_t *pulses, size_t count,
+                                uint32_t ticksPerUs) {
+  // Our start pulse and its release come first; the response low is the
+  // first low shorter than 200 us, followed by the response high.
+  uint32_t limit = PREAMBLE_MIN_US * (ticksPerUs ? ticksPerUs : 1);
+  size_t p = 0;
+  while (p < count && pulses[p] >= limit)
+    p += 2;
+  p += 2;
+  return p < count ? p : count;
+}
+
+DHTDecodeStatus DHTDecoder::decode(const uint32_t *pulses, size_t count,
+                                   uint32_t ticksPerUs, DHTFrame &frame) {
+  // Clean level durations, low/high alternating. A glitch splits one level
+  // into three pulses; stitch them back together.
+  uint32_t levels[2 * DHT_FRAME_BITS];
+  uint32_t glitch = GLITCH_MAX_US * ticksPerUs;
+  size_t n = 0;
+  bool timeout = false;
+  for (size_t i = 0; i < count && n < 2 * DHT_FRAME_BITS; i++) {
+    uint32_t d = pulses[i];
+    while (glitch && i + 2 < count && pulses[i + 1] < glitch &&
+           d != DHT_PULSE_TIMEOUT && pulses[i + 2] != DHT_PULSE_TIMEOUT) {
+      d += pulses[i + 1] + pulses[i + 2];
+      i += 2;
+    }
+    if (d == DHT_PULSE_TIMEOUT) {
+      timeout = true;
+      break;
+    }
+    levels[n++] = d;
+  }
+
+  for (uint8_t b = 0; b < 5; b++)
+    frame.data[b] = 0;
+  frame.bits = n / 2;
+  frame.minMargin = 100;
+  frame.weakestBit = 0;
+  frame.threshold = 0;
+
+  if (frame.bits > 0) {
+    // Threshold: mean low duration, about 50 us, between the ~27 us and
+    // ~70 us highs. Averaging keeps one disturbed low from flipping a bit.
+    uint32_t lowSum = 0;
+    for (uint8_t i = 0; i < frame.bits; i++)
+      lowSum += levels[2 * i];
+    uint32_t threshold = (lowSum + frame.bits / 2) / frame.bits;
+    frame.threshold = threshold;
+
+    for (uint8_t i = 0; i < frame.bits; i++) {
+      uint32_t high = levels[2 * i + 1];
+      uint32_t distance = high > threshold ? high - threshold : threshold - high;
+      uint32_t margin = threshold ? distance * 100 / threshold : 100;
+      frame.margin[i] = margin > 100 ? 100 : (uint8_t)margin;
+      if (frame.margin[i] < frame.minMargin) {
+        frame.minMargin = frame.margin[i];
+        frame.weakestBit = i;
+      }
+      frame.data[i / 8] <<= 1;
+      if (high > threshold)
+        frame.data[i / 8] |= 1;
+    }
+  }
+  for (uint8_t i = frame.bits; i < DHT_FRAME_BITS; i++)
+    frame.margin[i] = 0;
+
+  if (frame.bits < DHT_FRAME_BITS) {
+    // Left-align what arrived so partial bytes read the way they were sent.
+    if (frame.bits % 8)
+      frame.data[frame.bits / 8] <<= 8 - frame.bits % 8;
+    if (timeout)
+      frame.status = DHT_DECODE_TIMEOUT;
+    else
+      frame.status = frame.bits ? DHT_DECODE_TRUNCATED : DHT_DECODE_NO_REPLY;
+  } else if (frame.data[4] ==
+             ((frame.data[0] + frame.data[1] + frame.data[2] + frame.data[3]) &
+              0xFF)) {
+    frame.status = DHT_DECODE_OK;
+  } else {
+    frame.status = DHT_DECODE_CHECKSUM;
+  }
+  return frame.status;
+}
+
+size_t DHTDecoder::fromRmt(const uint32_t *symbols, size_t count,
+                           uint32_t *pulses, size_t maxPulses) {
+  size_t n = 0;
+  bool lastHigh = false;
+  for (size_t h = 0; h < 2 * count; h++) {
+    uint32_t half = h % 2 ? symbols[h / 2] >> 16 : symbols[h / 2] & 0xFFFF;
+    uint32_t duration = half & 0x7FFF;
+    bool high = half & 0x8000;
+    if (duration == 0)
+      break;
+    if (n == 0 && high)
+      continue; // leading high, before the first low
+    if (n > 0 && high == lastHigh) {
+      pulses[n - 1] += duration;
+      continue;
+    }
+    if (n == maxPulses)
+      break;
+    pulses[n++] = duration;
+    lastHigh = high;
+  }
+  return n;
+}
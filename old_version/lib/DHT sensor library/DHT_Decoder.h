@@ -0,0 +1,113 @@
+/*!
+ *  @file DHT_Decoder.h
+ *
+ *  Pure DHT frame decoder shared by every capture backend (bit-banged and
+ *  RMT). It only sees pulse durations, so it has no hardware or Arduino
+ *  dependencies and builds on a host as well.
+ *
+ *  MIT license, all text above must be included in any redistribution
+ */
+
+#ifndef DHT_DECODER_H
+#define DHT_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DHT_FRAME_BITS 40 /**< Bits in a DHT frame */
+#define DHT_PULSE_TIMEOUT                                                      \
+  UINT32_MAX /**< Marks a pulse that never ended (capture timeout) */
+#define DHT_MARGIN_WEAK 15 /**< Bits below this margin (percent) are shaky */
+
+/*!
+ *  @brief  Outcome of decoding one frame
+ */
+enum DHTDecodeStatus : uint8_t {
+  DHT_DECODE_OK,        /**< 40 bits and a matching checksum */
+  DHT_DECODE_NO_REPLY,  /**< No response pulse found */
+  DHT_DECODE_TIMEOUT,   /**< A pulse never ended */
+  DHT_DECODE_TRUNCATED, /**< Fewer than 40 bits */
+  DHT_DECODE_CHECKSUM   /**< 40 bits, checksum mismatch */
+};
+
+/*!
+ *  @brief  A decoded frame with per-bit confidence
+ */
+struct DHTFrame {
+  uint8_t data[5];              /**< Raw bytes, data[4] is the checksum */
+  uint8_t bits;                 /**< Bits decoded */
+  DHTDecodeStatus status;       /**< Overall result */
+  uint8_t margin[DHT_FRAME_BITS]; /**< Per bit: distance of the high pulse
+                                     from the 0/1 threshold, percent */
+  uint8_t minMargin;            /**< Smallest margin over decoded bits */
+  uint8_t weakestBit;           /**< Index of that bit */
+  uint32_t threshold;           /**< 0/1 threshold used, input units */
+};
+
+/*!
+ *  @brief  Decodes DHT pulse trains.
+ *
+ *  Pulses are durations of alternating levels, low first, in any unit:
+ *  microseconds, timer ticks or loop counts. Each bit is a ~50 us low
+ *  followed by a ~27 us (0) or ~70 us (1) high. The 0/1 threshold is the
+ *  mean low duration of the frame, so the decision does not depend on the
+ *  unit or clock, and each bit's margin is how far its high pulse sits
+ *  from that threshold relative to it.
+ */
+class DHTDecoder {
+public:
+  /*!
+   *  @brief  Index of the first data-bit low in a capture that still holds
+   *          the host start pulse and the sensor's 80 us response.
+   *  @param  pulses
+   *          durations, low first
+   *  @param  count
+   *          number of durations
+   *  @param  ticksPerUs
+   *          unit of the durations (pulses longer than 200 us are taken as
+   *          the host start pulse)
+   *  @return index of the first bit low, or count when there is no
+   *          response
+   */
+  static size_t skipPreamble(const uint32_t *pulses, size_t count,
+                             uint32_t ticksPerUs);
+
+  /*!
+   *  @brief  Decodes up to 40 bits.
+   *  @param  pulses
+   *          durations starting at the first data-bit low
+   *  @param  count
+   *          number of durations
+   *  @param  ticksPerUs
+   *          unit of the durations, for glitch rejection (pulses under
+   *          2 us are merged into their neighbours); 0 when unknown
+   *  @param  frame
+   *          result
+   *  @return frame.status
+   */
+  static DHTDecodeStatus decode(const uint32_t *pulses, size_t count,
+                                uint32_t ticksPerUs, DHTFrame &frame);
+
+  /*!
+   *  @brief  Flattens an RMT capture into durations, low first. Each 32-bit
+   *          symbol holds two halves, duration0:15 level0:1 duration1:15
+   *          level1:1 from the LSB, as in both rmt_item32_t and
+   *          rmt_symbol_word_t. Halves go by their level rather than their
+   *          position: leading highs (the idle bus) are skipped, halves of
+   *          the same level are one pulse, and a zero duration ends the
+   *          capture.
+   *  @param  symbols
+   *          captured symbols
+   *  @param  count
+   *          number of symbols
+   *  @param  pulses
+   *          durations out
+   *  @param  maxPulses
+   *          room in pulses
+   *  @return number of durations written
+   */
+  static size_t fromRmt(const uint32_t *symbols, size_t count,
+                        uint32_t *pulses, size_t maxPulses);
+};
+
+#endif
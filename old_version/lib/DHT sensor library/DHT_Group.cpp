@@ -0,0 +1,183 @@
+/*!
+ *  @file DHT_Group.cpp
+ *
+ *  Reads several DHT sensors in one go, see DHT_Group.h.
+ *
+ *  MIT license, all text above must be included in any redistribution
+ */
+
+#include "DHT_Group.h"
+
+#ifdef DHT_GROUP_PARALLEL
+#include <driver/gpio.h>
+#include <soc/gpio_struct.h>
+#endif
+
+#define DHT_GROUP_INTERVAL 2000 /**< Same minimum interval as DHT::read() */
+#define DHT_GROUP_WINDOW_US                                                    \
+  6000 /**< Release to last edge: response, 40 bits of at most 120 us each */
+
+/*!
+ *  @brief  Instantiates a group
+ *  @param  sensors
+ *          the DHT objects, at most DHT_GROUP_MAX
+ *  @param  count
+ *          number of sensors
+ */
+DHTGroup::DHTGroup(DHT *const *sensors, uint8_t count) {
+  _count = count < DHT_GROUP_MAX ? count : DHT_GROUP_MAX;
+  for (uint8_t i = 0; i < _count; i++)
+    _sensors[i] = sensors[i];
+  _valid = 0;
+  _lastreadtime = 0;
+}
+
+/*!
+ *  @brief  Sets up the data lines
+ *  @param  usec
+ *          pull-up time for the sequential fallback, see DHT::begin()
+ *  @return false if the pins cannot be sampled together (ESP32: all must
+ *          be below GPIO 32, in the same input register)
+ */
+bool DHTGroup::begin(uint8_t usec) {
+  _lastreadtime = millis() - DHT_GROUP_INTERVAL;
+#ifdef DHT_GROUP_PARALLEL
+  _mask = 0;
+  for (uint8_t i = 0; i < _count; i++) {
+    DHT &s = *_sensors[i];
+    if (s._pin >= 32)
+      return false;
+    _mask |= 1UL << s._pin;
+    s.pullTime = usec;
+    s._lastreadtime = _lastreadtime;
+    // Open drain with pull-up: writing 1 releases the line, so one register
+    // write starts or ends the start pulse on every sensor at once.
+    gpio_set_direction((gpio_num_t)s._pin, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_pull_mode((gpio_num_t)s._pin, GPIO_PULLUP_ONLY);
+  }
+  GPIO.out_w1ts = _mask;
+#else
+  for (uint8_t i = 0; i < _count; i++)
+    _sensors[i]->begin(usec);
+#endif
+  return true;
+}
+
+/*!
+ *  @brief  Reads every sensor, at most once per 2 s unless forced. Failed
+ *          frames are retried like DHT::read(), only for the sensors that
+ *          failed.
+ *  @param  force
+ *          read even if the last read was less than 2 s ago
+ *  @return bit i set if sensor i delivered a valid frame
+ */
+uint8_t DHTGroup::read(bool force) {
+#ifndef DHT_GROUP_PARALLEL
+  _valid = 0;
+  for (uint8_t i = 0; i < _count; i++)
+    if (_sensors[i]->read(force))
+      _valid |= 1 << i;
+  return _valid;
+#else
+  uint32_t currenttime = millis();
+  if (!force && (currenttime - _lastreadtime) < DHT_GROUP_INTERVAL)
+    return _valid;
+  _lastreadtime = currenttime;
+
+  // The start pulse has to suit the slowest sensor in the group.
+  bool longStart = false;
+  for (uint8_t i = 0; i < _count; i++) {
+    uint8_t type = _sensors[i]->_type;
+    if (type != DHT22 && type != DHT21)
+      longStart = true;
+  }
+
+  _valid = 0;
+  uint8_t todo = (1 << _count) - 1;
+  for (uint8_t retry = 0; todo; retry++) {
+    if (retry)
+      delay(DHT_RETRY_BACKOFF_MS << (retry - 1));
+
+    // The clock may have changed since the last read (frequency scaling).
+    uint32_t ticksPerUs = ESP.getCpuFreqMHz();
+    GPIO.out_w1tc = _mask;
+    if (longStart)
+      delay(20);
+    else
+      delayMicroseconds(1100);
+    capture(ticksPerUs);
+
+    uint8_t again = 0;
+    for (uint8_t i = 0; i < _count; i++) {
+      if (!(todo & (1 << i)))
+        continue;
+      DHT &s = *_sensors[i];
+      size_t p = DHTDecoder::skipPreamble(_pulses[i], _pulseCount[i], ticksPerUs);
+      DHTFrame frame;
+      DHTDecoder::decode(_pulses[i] + p, _pulseCount[i] - p, ticksPerUs, frame);
+      s._retry = retry;
+      s._lastreadtime = currenttime;
+      if (s.finishRead(frame))
+        _valid |= 1 << i;
+      else if (retry < DHT_READ_RETRIES && frame.status != DHT_DECODE_NO_REPLY)
+        again |= 1 << i;
+      else
+        s._stats.failed++;
+    }
+    todo = again;
+  }
+  return _valid;
+#endif
+}
+
+#ifdef DHT_GROUP_PARALLEL
+/*!
+ *  @brief  Ends the start pulse and records every sensor's level durations,
+ *          from its response low onwards, in cycles.
+ *  @param  ticksPerUs
+ *          CPU cycles per microsecond
+ */
+void DHTGroup::capture(uint32_t ticksPerUs) {
+  uint32_t bits[DHT_GROUP_MAX];
+  uint32_t edge[DHT_GROUP_MAX];
+  for (uint8_t i = 0; i < _count; i++) {
+    bits[i] = 1UL << _sensors[i]->_pin;
+    _pulseCount[i] = 0;
+  }
+  uint32_t window = DHT_GROUP_WINDOW_US * ticksPerUs;
+  uint32_t pending = _mask;
+  uint32_t started = 0;
+  uint32_t last = 0; // all lines are held low until the release below
+
+  InterruptLock lock;
+  uint32_t start = ESP.getCycleCount();
+  GPIO.out_w1ts = _mask;
+  while (pending) {
+    uint32_t now = ESP.getCycleCount();
+    uint32_t port = GPIO.in;
+    uint32_t changed = (port ^ last) & pending;
+    last = port;
+    if (changed) {
+      for (uint8_t i = 0; i < _count; i++) {
+        if (!(changed & bits[i]))
+          continue;
+        if (!(started & bits[i])) {
+          // Ignore the line rising after the release; the sensor's
+          // response starts at its first falling edge.
+          if (!(port & bits[i])) {
+            started |= bits[i];
+            edge[i] = now;
+          }
+          continue;
+        }
+        _pulses[i][_pulseCount[i]++] = now - edge[i];
+        edge[i] = now;
+        if (_pulseCount[i] == DHT_GROUP_PULSES)
+          pending &= ~bits[i];
+      }
+    }
+    if (now - start > window)
+      break;
+  }
+}
+#endif
@@ -0,0 +1,56 @@
+/*!
+ *  @file DHT_Group.h
+ *
+ *  Reads several DHT sensors in one go: a single start pulse for all of
+ *  them, then every data line is sampled from one GPIO input register read
+ *  per tick and the bitstreams are separated afterwards. N sensors cost
+ *  about the wall time and interrupt-off window of one.
+ *
+ *  MIT license, all text above must be included in any redistribution
+ */
+
+#ifndef DHT_GROUP_H
+#define DHT_GROUP_H
+
+#include "DHT.h"
+
+/* Parallel capture needs the ESP32 GPIO registers and cycle counter; other
+ * platforms read the sensors one after the other. */
+#if defined(ESP32) && defined(DHT_CYCLE_COUNTER)
+#define DHT_GROUP_PARALLEL
+#endif
+
+#ifndef DHT_GROUP_MAX
+#define DHT_GROUP_MAX 4 /**< Sensors per group */
+#endif
+#define DHT_GROUP_PULSES 82 /**< Response low/high plus 40 low/high bits */
+
+/*!
+ *  @brief  Several DHT sensors read together.
+ *
+ *  The sensors are ordinary DHT objects that must not be begin()'d on their
+ *  own. After read(), their readTemperature() and readHumidity() return the
+ *  group's frame until the next read interval, and their getStats() count
+ *  the group's attempts.
+ */
+class DHTGroup {
+public:
+  DHTGroup(DHT *const *sensors, uint8_t count);
+  bool begin(uint8_t usec = 55);
+  uint8_t read(bool force = false);
+
+private:
+  DHT *_sensors[DHT_GROUP_MAX];
+  uint8_t _count;
+  uint8_t _valid; // bit i: sensor i has a good frame
+  uint32_t _lastreadtime;
+#ifdef DHT_GROUP_PARALLEL
+  uint32_t _mask;
+  uint32_t _pulses[DHT_GROUP_MAX][DHT_GROUP_PULSES];
+  uint8_t _pulseCount[DHT_GROUP_MAX];
+
+  void capture(uint32_t ticksPerUs);
+#endif
+};
+
+#endif
@@ -37,6 +37,25 @@ DHT_Unified::DHT_Unified(uint8_t pin, uint8_t type, uint8_t count,
  */
 void DHT_Unified::begin() { _dht.begin(); }
 
+/*!
+ *  @brief  Reads the sensor once and queues both readings, temperature
+ *          first, with the same timestamp
+ *  @param  ring
+ *          ring to append to
+ *  @return number of events queued (fewer than 2 if the ring was full)
+ */
+uint16_t DHT_Unified::getEvents(Adafruit_SensorRing *ring) {
+  sensors_event_t event;
+  uint16_t queued = 0;
+  _temp.getEvent(&event);
+  int32_t timestamp = event.timestamp;
+  queued += ring->push(&event);
+  _humidity.getEvent(&event);
+  event.timestamp = timestamp;
+  queued += ring->push(&event);
+  return queued;
+}
+
 /*!
  *  @brief  Sets sensor name
  *  @param  sensor
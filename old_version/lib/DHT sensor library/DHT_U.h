@@ -47,6 +47,7 @@ public:
   DHT_Unified(uint8_t pin, uint8_t type, uint8_t count = 6,
               int32_t tempSensorId = -1, int32_t humiditySensorId = -1);
   void begin();
+  uint16_t getEvents(Adafruit_SensorRing *ring);
 
   /*!
    *  @brief  Class that stores state and functions about Temperature
@@ -56,6 +57,9 @@ public:
     Temperature(DHT_Unified *parent, int32_t id);
     bool getEvent(sensors_event_t *event);
     void getSensor(sensor_t *sensor);
+    uint16_t getEvents(Adafruit_SensorRing *ring) {
+      return _parent->getEvents(ring);
+    }
 
   private:
     DHT_Unified *_parent;
@@ -70,6 +74,9 @@ public:
     Humidity(DHT_Unified *parent, int32_t id);
     bool getEvent(sensors_event_t *event);
     void getSensor(sensor_t *sensor);
+    uint16_t getEvents(Adafruit_SensorRing *ring) {
+      return _parent->getEvents(ring);
+    }
 
   private:
     DHT_Unified *_parent;
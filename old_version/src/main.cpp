@@ -3,9 +3,28 @@
 #include <Wire.h>
 #include <U8x8lib.h>
 #include <Ds1302.h>
-
-#define PUMP_PIN_1 26
-#define PUMP_PIN_2 25
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <driver/uart.h>
+#include <esp_sleep.h>
+
+#include "SoilCalibration.h"
+#include "StreamingStats.h"
+#include "ZoneTable.h"
+#include "PowerScheduler.h"
+#include "DryingEstimator.h"
+#include "TimeSeriesLog.h"
+#include "HistoryRollup.h"
+#include "SerialConsole.h"
+#include "ButtonInput.h"
+#include "Seqlock.h"
+#include "SystemState.h"
+#include "Coroutine.h"
+#include "RuleEngine.h"
+#include "Board.h"
+#include "Psychrometrics.h"
+#include "SensorHealth.h"
 
 #define PIN_SDA 22
 #define PIN_SCL 23
@@ -21,28 +40,71 @@
 
 #define LINE_WIDTH 16
 
+#define POWER_BUDGET_MA    1000   // what the supply holds without browning out
+#define POWER_SOFTSTART_MS 500    // gap between actuator starts
+
 #define DHTPIN 5
 #define DHTTYPE DHT11
 
+// Control and sensing own APP_CPU; display, buttons and serial I/O run on
+// PRO_CPU so slow I2C and UART writes never delay a pump switching off.
+#define CONTROL_CORE      APP_CPU_NUM
+#define UI_CORE           PRO_CPU_NUM
+#define CONTROL_PRIORITY  3
+#define UI_PRIORITY       1
+#define UI_PERIOD_MS      10
+// With the data screen up and no button or console input for this long,
+// the control task light-sleeps in short naps whenever nothing it times is
+// running. Shorter windows than UI_NAP_MIN_MS are not worth the wakeup.
+#define UI_IDLE_AFTER_MS  30000
+#define UI_NAP_MS         1000
+#define UI_NAP_MIN_MS     50
+// Flash writes of the history log: below everything else, off APP_CPU.
+#define HISTORY_CORE      PRO_CPU_NUM
+#define HISTORY_PRIORITY  0
+
 const char* menuItems[] = {"Data", "SetTime"};
 int menuSize = sizeof(menuItems) / sizeof(menuItems[0]);
 
-const int BUTTON1_PIN = 17;
-const int BUTTON2_PIN = 16;
-const int BUTTON3_PIN = 4;
-const int BUTTON4_PIN = 15;
-const unsigned long BUTTON4_DEBOUNCE_MS = 50;
-const unsigned long BUTTON4_REPEAT_MS   = 200;
-
-enum ButtonMode {
-  BUTTON_TOGGLE,
-  BUTTON_HOLD,
-  BUTTON_PULSE,
-  BUTTON_REPEAT
+// Board outputs and inputs, resolved at compile time (see Board.h).
+typedef Actuator<26> Pump1;
+typedef Actuator<25> Pump2;
+typedef ActuatorList<Pump1, Pump2> Pumps;
+typedef Actuator<27> SoilPower;              // probe supply, off between readings
+
+typedef PinList<17, 16, 4, 15> ButtonPins;   // active low, in menu order
+
+constexpr ZoneConfig zoneConfig[] = {
+  // adc pin,        mux channel, pump, mA,  threshold %, max/week
+  {PIN_SOILSENSOR_1, ZONE_DIRECT, 0,    600, 20, 5},
+  {PIN_SOILSENSOR_2, ZONE_DIRECT, 1,    600, 30, 5},
 };
+const uint8_t zoneCount = sizeof(zoneConfig) / sizeof(zoneConfig[0]);
+
+constexpr bool zoneTableValid(const ZoneConfig *c, uint8_t n) {
+  return n == 0 || (isAdc1Pin(c->adcPin) && c->pump < Pumps::count && zoneTableValid(c + 1, n - 1));
+}
+static_assert(zoneCount <= MAX_ZONES, "too many zones");
+static_assert(zoneTableValid(zoneConfig, zoneCount),
+              "every zone needs an ADC1 pin and a pump from Pumps");
+
+// Rollups cover temperature, humidity and every configured zone.
+typedef HistoryRollup<SERIES_MOISTURE(zoneCount)> Rollup;
+
+// Soil sampling plus one dose sequence per zone, with room to spare.
+typedef CoScheduler<2 * MAX_ZONES> Scheduler;
+
+// Coroutine events: bit z = pump z has stopped.
+#define EVENT_PUMP_STOPPED(z) (1UL << (z))
 
 U8X8_SSD1306_128X64_NONAME_HW_I2C u8x8(U8X8_PIN_NONE);
 
+// Everything the control side prints is queued here and written to Serial
+// by the UI task.
+RingPrint Log;
+// Console lines and menu actions, UI task -> control task.
+SpscRing<ConsoleLine, 4> commandLines;
+
 class RTCManager {
 private:
   Ds1302 rtc;
@@ -58,7 +120,7 @@ public:
     rtc.init();
 
     if (rtc.isHalted()) {
-      Serial.println("Setting default time...");
+      Log.println("Setting default time...");
       Ds1302::DateTime dt;
       dt.year   = 25;
       dt.month  = 11;
@@ -123,6 +185,46 @@ bool getFormattedMonthDayTime(char *buf, size_t size) {
   return false;
 }
 
+// Seconds since 2000-01-01 00:00:00, the time base of the history log.
+uint32_t getEpoch() {
+  Ds1302::DateTime now;
+  rtc.getDateTime(&now);
+  return toEpoch(now);
+}
+
+static uint32_t toEpoch(const Ds1302::DateTime &dt) {
+  static const uint16_t daysBeforeMonth[12] = {
+      0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+  uint32_t y = dt.year;
+  uint32_t days = y * 365UL + (y + 3) / 4;
+  days += daysBeforeMonth[(dt.month - 1) % 12] + dt.day - 1;
+  if (dt.month > 2 && y % 4 == 0) days++;
+  return ((days * 24UL + dt.hour) * 60UL + dt.minute) * 60UL + dt.second;
+}
+
+static void fromEpoch(uint32_t epoch, Ds1302::DateTime &dt) {
+  uint32_t days = epoch / 86400UL;
+  uint32_t secs = epoch % 86400UL;
+  dt.hour = secs / 3600;
+  dt.minute = secs / 60 % 60;
+  dt.second = secs % 60;
+  dt.dow = (days + 5) % 7 + 1;          // 2000-01-01 was a Saturday
+
+  uint8_t y = 0;
+  while (days >= (y % 4 == 0 ? 366UL : 365UL)) days -= (y++ % 4 == 0 ? 366UL : 365UL);
+  static const uint8_t monthDays[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  uint8_t m = 0;
+  while (m < 11) {
+    uint8_t len = monthDays[m] + (m == 1 && y % 4 == 0 ? 1 : 0);
+    if (days < len) break;
+    days -= len;
+    m++;
+  }
+  dt.year = y;
+  dt.month = m + 1;
+  dt.day = days + 1;
+}
+
 void setDateTime(const Ds1302::DateTime &dt) {
   Ds1302::DateTime temp = dt;
   rtc.setDateTime(&temp);
@@ -130,27 +232,27 @@ void setDateTime(const Ds1302::DateTime &dt) {
 
 private:
   void printTime(const Ds1302::DateTime& now) {
-    Serial.print("20");
-    if (now.year < 10) Serial.print('0');
-    Serial.print(now.year);
-    Serial.print('-');
-    if (now.month < 10) Serial.print('0');
-    Serial.print(now.month);
-    Serial.print('-');
-    if (now.day < 10) Serial.print('0');
-    Serial.print(now.day);
-    Serial.print(' ');
-    Serial.print(WeekDays[now.dow - 1]);
-    Serial.print(' ');
-    if (now.hour < 10) Serial.print('0');
-    Serial.print(now.hour);
-    Serial.print(':');
-    if (now.minute < 10) Serial.print('0');
-    Serial.print(now.minute);
-    Serial.print(':');
-    if (now.second < 10) Serial.print('0');
-    Serial.print(now.second);
-    Serial.println();
+    Log.print("20");
+    if (now.year < 10) Log.print('0');
+    Log.print(now.year);
+    Log.print('-');
+    if (now.month < 10) Log.print('0');
+    Log.print(now.month);
+    Log.print('-');
+    if (now.day < 10) Log.print('0');
+    Log.print(now.day);
+    Log.print(' ');
+    Log.print(WeekDays[now.dow - 1]);
+    Log.print(' ');
+    if (now.hour < 10) Log.print('0');
+    Log.print(now.hour);
+    Log.print(':');
+    if (now.minute < 10) Log.print('0');
+    Log.print(now.minute);
+    Log.print(':');
+    if (now.second < 10) Log.print('0');
+    Log.print(now.second);
+    Log.println();
   }
 };
 const char* RTCManager::WeekDays[7] = {
@@ -158,317 +260,512 @@ const char* RTCManager::WeekDays[7] = {
 };
 RTCManager rtcManager(PIN_ENA, PIN_CLK, PIN_DAT);
 
-class SoilSensor {
-private:
-    uint8_t pin;
-    uint8_t displayRow;
-    U8X8_SSD1306_128X64_NONAME_HW_I2C &display;
+// Plausibility limits. Soil in mV: a connected probe never reads the
+// rails, and does not move 300 mV plus 1 mV/s between readings unless it
+// was just watered. DHT in degC / %RH: 0 %RH is the classic dead-sensor
+// value; stuck checks are off since a DHT11 at 1-count resolution can sit
+// on one value for hours.
+const SensorLimits soilLimits  = {50, 2950, 150, 300, 1.0f, 0.5f, 12};
+const SensorLimits tempLimits  = {-10, 60, 3, 3, 0.05f, 0, 0};
+const SensorLimits humLimits   = {1, 100, 10, 15, 0.5f, 0, 0};
 
-    unsigned long lastSampleTime;
-    unsigned long lastUpdateTime;
-
-    float voltageSum;
-    uint16_t sampleCount;
-
-    float lastVoltage;
-    float lastMoisture;
-    bool valid;
-
-    const float a = -1.176;
-    const float b = 1.77;
-    const float moistureError = 8.0f; // ±8%
-
-public:
-  SoilSensor(uint8_t p, uint8_t row, U8X8_SSD1306_128X64_NONAME_HW_I2C &disp)
-      : pin(p), displayRow(row), display(disp),
-        lastSampleTime(0), lastUpdateTime(0),
-        voltageSum(0), sampleCount(0),
-        lastVoltage(0), lastMoisture(0),
-        valid(false)
-  {}
-
-  void begin() {
-    pinMode(pin, INPUT);
-  }
-
-  void update(bool showOnOLED) {
-    unsigned long now = millis();
-    if (now - lastSampleTime >= 1000) {
-      lastSampleTime = now;
-      int raw = analogRead(pin);
-      float v = raw * 3.0f / 4095.0f;
-      voltageSum += v;
-      sampleCount++;
+class SoilSensorBank : public Coroutine {
+private:
+    ZoneState &zones;
+    ActuatorWrite power;
+    const uint8_t *muxSelect;
+
+    P2Quantile<float> median[MAX_ZONES];
+    RunningStats<float> spread[MAX_ZONES];
+    uint16_t generation;
+    uint16_t windowMask;     // zones sampled in the current burst
+    uint32_t poweredAt;      // micros() when the probes were switched on
+    uint32_t lastOnUs;
+    uint64_t totalOnUs;
+
+    static const uint16_t BURST_SAMPLES = 16;
+    static const unsigned long SETTLE_MS = 20;       // probe output settles
+    static const unsigned long MIN_INTERVAL = 5000;  // between bursts
+
+    SoilCalibration calibration[MAX_ZONES];
+    SensorHealth health[MAX_ZONES];
+
+    static const uint32_t WATERED_MS = 30UL * 60UL * 1000UL;  // moisture moves fast
+    static const uint16_t CROSS_MARGIN_MV = 150;   // beyond the calibrated span
+
+    void selectMux(uint8_t channel) {
+      for (uint8_t i = 0; i < 4; i++) {
+        digitalWrite(muxSelect[i], (channel >> i) & 1);
+      }
+      delayMicroseconds(10);
     }
 
-    if (now - lastUpdateTime >= 5000) {
-      lastUpdateTime = now;
-      if (sampleCount > 0) {
-        lastVoltage = voltageSum / sampleCount;
-        voltageSum = 0;
-        sampleCount = 0;
-
-        float h = (lastVoltage - b) / a;
-        if (h < 0) h = 0;
-        if (h > 1) h = 1;
-        lastMoisture = h * 100.0f;
-        valid = true;
+    uint16_t dueZones() const {
+      uint32_t now = millis();
+      uint16_t due = 0;
+      for (uint8_t z = 0; z < zones.count; z++) {
+        if ((int32_t)(now - zones.nextCheck[z]) >= 0) due |= ZoneState::bit(z);
       }
-      if (showOnOLED) displayLast();
-      }
-  }
-
-  float getLatestMoisture() const {
-    return valid ? lastMoisture : NAN;
-  }
-
-  void displayLast() {
-    char buf[20];
-    snprintf(buf, sizeof(buf),
-            "M%d: %.1f%% (%.0f%%)",
-            (displayRow - 2),
-            lastMoisture,
-            moistureError);
-    display.drawString(0, displayRow, buf);
-  }
-
-  float getMoisture() const { return lastMoisture; }
-  bool hasValid() const { return valid; }
-};
+      return due;
+    }
 
-class Button {
-  public:
-    Button(int pin, ButtonMode mode, unsigned long debounce = 20, unsigned long repeatInterval = 500)
-      : _pin(pin), _mode(mode), _debounce(debounce), _repeatInterval(repeatInterval),
-        _lastState(HIGH), _buttonState(HIGH), _lastDebounceTime(0),
-        _output(false), _lastOutputTime(0) {
-      pinMode(pin, INPUT_PULLUP);
+    void powerOn() {
+      if (power) power(true);
+      poweredAt = micros();
     }
 
-    bool update() {
-      bool reading = digitalRead(_pin);
+    void powerOff() {
+      if (power) power(false);
+      lastOnUs = micros() - poweredAt;
+      totalOnUs += lastOnUs;
+    }
 
-      debounceCheck(reading);
+    // Reads every zone of the window back to back, one zone at a time so
+    // the mux switches once per zone. The first conversion after a switch
+    // still carries the previous channel on the ADC's sample capacitor and
+    // is dropped. About 1 ms for two zones.
+    void sampleBurst() {
+      for (uint8_t z = 0; z < zones.count; z++) {
+        if (!(windowMask & ZoneState::bit(z))) continue;
+        if (zones.muxChannel[z] != ZONE_DIRECT && muxSelect) {
+          selectMux(zones.muxChannel[z]);
+        }
+        median[z].reset();
+        spread[z].reset();
+        analogRead(zones.adcPin[z]);
+        for (uint16_t i = 0; i < BURST_SAMPLES; i++) {
+          float mv = analogRead(zones.adcPin[z]) * 3000.0f / 4095.0f;
+          median[z].add(mv);
+          spread[z].add(mv);
+        }
+      }
+    }
 
-      if ((millis() - _lastDebounceTime) > _debounce) {
-        bool lastLogic = _buttonState;
-        _buttonState = reading;
+    // Moisture from the zone's latest millivolts. Without a usable table the
+    // zone has no moisture at all, so watering and rules stop acting on it.
+    void applyCalibration(uint8_t z) {
+      uint16_t bit = ZoneState::bit(z);
+      int16_t permille = calibration[z].evaluate(zones.millivolts[z]);
+      if (permille >= 0) {
+        zones.moisture[z] = permille;
+        zones.valid |= bit;
+        zones.uncalibrated &= ~bit;
+      } else {
+        zones.valid &= ~bit;
+        zones.uncalibrated |= bit;
+      }
+    }
 
-        switch (_mode) {
-          case BUTTON_TOGGLE:
-            handleToggle(lastLogic);
-            break;
+    void publish() {
+      uint32_t now = millis();
+      for (uint8_t z = 0; z < zones.count; z++) {
+        if (!(windowMask & ZoneState::bit(z))) continue;
+        uint16_t mv = (uint16_t)lroundf(median[z].value());
+        zones.millivolts[z] = mv;
+        zones.noiseMv[z] = (uint16_t)lroundf(spread[z].stddev());
+        zones.readingAt[z] = now;
+        zones.nextCheck[z] = now;
+
+        applyCalibration(z);
+      }
+      checkHealth(now);
+      windowMask = 0;
+      generation++;
+    }
 
-          case BUTTON_HOLD:
-            handleHold();
-            break;
+    bool recentlyWatered(uint8_t z, uint32_t now) const {
+      uint16_t bit = ZoneState::bit(z);
+      return (zones.dosing & bit) || ((zones.watered & bit) && now - zones.pumpStart[z] < WATERED_MS);
+    }
 
-          case BUTTON_PULSE:
-            handlePulse(lastLogic);
-            break;
+    // True when mv lies well outside the voltages the zone was calibrated
+    // over: moisture is clamped there, so only the raw reading shows it.
+    bool beyondCalibration(uint8_t z, uint16_t mv) const {
+      const SoilCalibration &c = calibration[z];
+      if (!c.isUsable()) return false;
+      return mv + CROSS_MARGIN_MV < c.pointMv(0) ||
+             mv > c.pointMv(c.size() - 1) + CROSS_MARGIN_MV;
+    }
 
-          case BUTTON_REPEAT:
-            handleRepeat();
-            break;
+    // Runs each new reading through its zone's checks. The cross-zone check
+    // flags a probe whose raw voltage left its calibrated span (open or
+    // shorted probe, corroded contact) while another healthy zone still
+    // reads inside its own. A pot that has simply dried out stays near its
+    // dry calibration point and is not flagged. One count up front, O(1)
+    // per zone.
+    void checkHealth(uint32_t now) {
+      uint8_t inside = 0;
+      for (uint8_t z = 0; z < zones.count; z++) {
+        if (zones.isValid(z) && !zones.isSuspect(z) && !beyondCalibration(z, zones.millivolts[z])) {
+          inside++;
         }
       }
 
-      _lastState = reading;
-      return _output;
+      for (uint8_t z = 0; z < zones.count; z++) {
+        uint16_t bit = ZoneState::bit(z);
+        if (!(windowMask & bit)) continue;
+        uint8_t extra = 0;
+        if (inside > 0 && beyondCalibration(z, zones.millivolts[z])) extra = FAULT_CROSS;
+
+        bool was = health[z].isDegraded();
+        health[z].check(zones.millivolts[z], zones.noiseMv[z], now, recentlyWatered(z, now), extra);
+        zones.faults[z] = health[z].getSeen();
+        if (health[z].isDegraded()) zones.degraded |= bit;
+        else zones.degraded &= ~bit;
+
+        if (!was && health[z].isDegraded()) {
+          Log.printf("Zone %u: probe fault (%s), watering suspended\n",
+                     (unsigned)(z + 1), SensorHealth::name(zones.faults[z]));
+        } else if (was && !health[z].isDegraded()) {
+          Log.printf("Zone %u: probe recovered\n", (unsigned)(z + 1));
+        }
+      }
     }
 
-  private:
-    int _pin;
-    ButtonMode _mode;
-    unsigned long _debounce;
-    unsigned long _repeatInterval;
-
-    bool _lastState;
-    bool _buttonState;
-    unsigned long _lastDebounceTime;
-
-    bool _output;
-    unsigned long _lastOutputTime;
+public:
+  // powerSwitch: switches the probe supply, or nullptr when the probes are
+  // always powered. muxPins: S0..S3 of the analog mux, or nullptr when no
+  // zone uses one.
+  SoilSensorBank(ZoneState &z, ActuatorWrite powerSwitch,
+                 const uint8_t *muxPins = nullptr)
+      : zones(z), power(powerSwitch), muxSelect(muxPins),
+        generation(0), windowMask(0), poweredAt(0), lastOnUs(0), totalOnUs(0)
+  {}
 
-    void debounceCheck(bool reading) {
-      if (reading != _lastState) {
-        _lastDebounceTime = millis();
+  void begin() {
+    for (uint8_t z = 0; z < zones.count; z++) {
+      health[z].begin(soilLimits);
+      pinMode(zones.adcPin[z], INPUT);
+      if (calibration[z].load(z + 1)) {
+        Log.printf("Zone %u: %u-point calibration loaded\n",
+                      (unsigned)(z + 1), (unsigned)calibration[z].size());
       }
+      recalibrated(z);
     }
+    if (muxSelect) {
+      for (uint8_t i = 0; i < 4; i++) pinMode(muxSelect[i], OUTPUT);
+    }
+  }
 
-    void handleToggle(bool lastLogic) {
-      if (lastLogic == HIGH && _buttonState == LOW) {
-        _output = !_output;
-      }
+  // Zones whose nextCheck is due are read together in one burst: probes
+  // on, SETTLE_MS to settle, BURST_SAMPLES conversions per zone, probes
+  // off. Their medians (robust to ADC spikes) and spreads are published.
+  // Resistive probes corrode while powered, so they are on for ~20 ms per
+  // reading instead of all the time. A zone is due again right away
+  // unless something (DryingEstimator) pushes its nextCheck out; bursts
+  // are at least MIN_INTERVAL apart either way.
+  bool step() override {
+    CO_BEGIN();
+    for (;;) {
+      CO_WAIT_UNTIL((windowMask = dueZones()) != 0);
+      powerOn();
+      CO_SLEEP_FOR(SETTLE_MS);
+      windowMask |= dueZones();
+      sampleBurst();
+      powerOff();
+      publish();
+      CO_SLEEP_FOR(MIN_INTERVAL);
     }
+    CO_END();
+  }
 
-    void handleHold() {
-      _output = (_buttonState == LOW);
+  // How long the bank can be stopped without delaying a burst: 0 while the
+  // probes are powered, else until the next zone is due or the rest between
+  // bursts ends, whichever is later.
+  uint32_t idleFor(uint32_t now) const {
+    if (windowMask) return 0;
+    int32_t ms = INT32_MAX;
+    for (uint8_t z = 0; z < zones.count; z++) {
+      int32_t due = (int32_t)(zones.nextCheck[z] - now);
+      if (due < ms) ms = due;
     }
+    if (wait == CO_WAIT_SLEEP && (int32_t)(wakeAt - now) > ms) ms = (int32_t)(wakeAt - now);
+    return ms > 0 ? (uint32_t)ms : 0;
+  }
 
-    void handlePulse(bool lastLogic) {
-      _output = (lastLogic == HIGH && _buttonState == LOW);
+  // Bumped every time new readings are published.
+  uint16_t getGeneration() const { return generation; }
+  // Probe supply on-time of the last burst and since boot, microseconds.
+  uint32_t getLastOnTime() const { return lastOnUs; }
+  uint64_t getTotalOnTime() const { return totalOnUs; }
+  SoilCalibration &getCalibration(uint8_t z) { return calibration[z]; }
+  // After the zone's table was edited: takes effect on the current reading
+  // right away instead of at the next burst.
+  void recalibrated(uint8_t z) {
+    if (zones.readingAt[z]) {
+      applyCalibration(z);
+    } else if (calibration[z].isUsable()) {
+      zones.uncalibrated &= ~ZoneState::bit(z);
+    } else {
+      zones.uncalibrated |= ZoneState::bit(z);
     }
+  }
+  const SensorHealth &getHealth(uint8_t z) const { return health[z]; }
 
-    void handleRepeat() {
-      if (_buttonState == LOW) {
-        if (millis() - _lastOutputTime >= _repeatInterval) {
-          _output = true;
-          _lastOutputTime = millis();
-        } else {
-          _output = false;
-        }
-      } else {
-        _output = false;
-      }
+  void resetHealth() {
+    for (uint8_t z = 0; z < zones.count; z++) {
+      health[z].reset();
+      zones.faults[z] = 0;
     }
+    zones.degraded = 0;
+  }
 };
 
-class DHT_Display {
+// Samples the DHT with adaptive rate and publishes 5 s averages.
+class ClimateSensor {
 private:
   DHT dht;
-  uint8_t row;
   float lastTemp;
   float lastHum;
   unsigned long lastSampleTime;
   unsigned long lastUpdateTime;
-  float tempSum;
-  float humSum;
-  int sampleCount;
+  RunningStats<float> tempWindow;
+  RunningStats<float> humWindow;
+  Ewma<float> tempTrend;
+  Ewma<float> humTrend;
+  RateOfChange<float> tempRate;
+  uint16_t updates;
+  bool suspect;
+  uint16_t windowReads;
+  SensorHealth tempHealth;
+  SensorHealth humHealth;
 
   bool fastMode;
   const unsigned long sampleIntervalSlow = 2500; // 2.5s
   const unsigned long sampleIntervalFast = 1000; // 1s
   const unsigned long updateInterval = 5000;     // 5s
-  const float tempThreshold = 3.0;               // ℃
-  const float humThreshold  = 20.0;              // %
+  const float tempResolution = 1.0;              // ℃, DHT11
+  const float humResolution  = 1.0;              // %
+  const float enterFastScore = 3.0;              // standard deviations
+  const float leaveFastScore = 1.5;
+  const uint32_t qualityMinFrames = 20;          // before judging read quality
+
+  // How far a new window mean sits from the smoothed history, in standard
+  // deviations. The sensor resolution is a floor on the spread so a dead
+  // steady reading does not make every 1-count step look significant.
+  static float changeScore(const Ewma<float> &trend, const RunningStats<float> &window,
+                           float resolution) {
+    if (!trend.ready() || window.count() == 0) return 0;
+    float var = trend.variance() + window.variance() / window.count() +
+                resolution * resolution * 0.25f;
+    return fabsf(window.mean() - trend.mean()) / sqrtf(var);
+  }
 
 public:
-  DHT_Display(uint8_t pin, uint8_t r) : dht(pin, DHTTYPE), row(r),
+  ClimateSensor(uint8_t pin) : dht(pin, DHTTYPE),
                                         lastTemp(NAN), lastHum(NAN),
                                         lastSampleTime(0), lastUpdateTime(0),
-                                        tempSum(0), humSum(0), sampleCount(0),
+                                        tempTrend(0.2f), humTrend(0.2f), tempRate(0.3f),
+                                        updates(0), suspect(false), windowReads(0),
                                         fastMode(false) {}
 
   void begin() {
     dht.begin();
+    tempHealth.begin(tempLimits);
+    humHealth.begin(humLimits);
   }
 
-  // now takes a flag: if showOnOLED==true then draws to OLED; otherwise only samples + Serial
-  void update(bool showOnOLED) {
+  void update() {
     unsigned long now = millis();
 
     unsigned long interval = fastMode ? sampleIntervalFast : sampleIntervalSlow;
     if (now - lastSampleTime >= interval) {
       lastSampleTime = now;
+      windowReads++;
       float t = dht.readTemperature();
       float h = dht.readHumidity();
-      if (!isnan(t)) tempSum += t;
-      if (!isnan(h)) humSum += h;
-      sampleCount++;
+      if (!isnan(t)) tempWindow.add(t);
+      if (!isnan(h)) humWindow.add(h);
     }
 
     if (now - lastUpdateTime >= updateInterval) {
       lastUpdateTime = now;
 
-      float avgTemp = NAN;
-      float avgHum  = NAN;
-
-      if (sampleCount > 0) {
-        avgTemp = tempSum / sampleCount;
-        avgHum  = humSum  / sampleCount;
+      float avgTemp = tempWindow.mean();
+      float avgHum  = humWindow.mean();
+
+      // A window where most reads failed is missing, not a smaller average.
+      bool wasDegraded = isDegraded();
+      uint8_t tf = tempWindow.count() * 2 < windowReads
+                       ? tempHealth.missing()
+                       : tempHealth.check(avgTemp, tempWindow.stddev(), now);
+      uint8_t hf = humWindow.count() * 2 < windowReads
+                       ? humHealth.missing()
+                       : humHealth.check(avgHum, humWindow.stddev(), now);
+      if (tf) avgTemp = NAN;
+      if (hf) avgHum = NAN;
+      if (!wasDegraded && isDegraded()) {
+        Log.printf("DHT fault (%s), readings withheld\n", SensorHealth::name(getFaults()));
+      } else if (wasDegraded && !isDegraded()) {
+        Log.println("DHT recovered");
       }
 
-      char buf[40];
-      snprintf(buf, sizeof(buf), "T=%.1f H=%.1f", avgTemp, avgHum);
-      Serial.println(buf);
-
-      if (showOnOLED) {
-        display(avgTemp, avgHum);
+      if (!isnan(avgTemp)) tempRate.add(now, avgTemp);
+
+      char buf[72];
+      snprintf(buf, sizeof(buf), "T=%.1f H=%.1f dT=%+.1f/h VPD=%.2f Td=%.1f", avgTemp, avgHum,
+               tempRate.perSecond() * 3600.0f, Psychrometrics::vpd(avgTemp, avgHum),
+               Psychrometrics::dewPoint(avgTemp, avgHum));
+      Log.println(buf);
+
+      // Sample faster while the climate moves more than its usual spread,
+      // with hysteresis so the mode does not chatter.
+      float score = fmaxf(changeScore(tempTrend, tempWindow, tempResolution),
+                          changeScore(humTrend, humWindow, humResolution));
+      if (!fastMode && score > enterFastScore) fastMode = true;
+      else if (fastMode && score < leaveFastScore) fastMode = false;
+
+      // A degraded channel publishes NAN, which every consumer already
+      // treats as unknown; a single bad window keeps the previous value.
+      if (!isnan(avgTemp)) {
+        lastTemp = avgTemp;
+        tempTrend.add(avgTemp);
+      } else if (tempHealth.isDegraded()) {
+        lastTemp = NAN;
       }
-
-      if (!isnan(avgTemp) && !isnan(avgHum) && !isnan(lastTemp) && !isnan(lastHum)) {
-        if (!fastMode) {
-          if (abs(avgTemp - lastTemp) > tempThreshold || abs(avgHum - lastHum) > humThreshold) {
-            fastMode = true;
-          }
-        } else {
-          if (abs(avgTemp - lastTemp) <= tempThreshold && abs(avgHum - lastHum) <= humThreshold) {
-            fastMode = false;
-          }
-        }
+      if (!isnan(avgHum)) {
+        lastHum = avgHum;
+        humTrend.add(avgHum);
+      } else if (humHealth.isDegraded()) {
+        lastHum = NAN;
       }
+      updates++;
 
-      if (!isnan(avgTemp)) lastTemp = avgTemp;
-      if (!isnan(avgHum))  lastHum  = avgHum;
+      bool poor = readQualityPoor();
+      if (poor && !suspect) Log.println("DHT read quality poor, see 'stats'");
+      suspect = poor;
 
-      tempSum = 0;
-      humSum = 0;
-      sampleCount = 0;
+      tempWindow.reset();
+      humWindow.reset();
+      windowReads = 0;
     }
   }
 
-  void display(float temp, float hum) {
-    char buffer[32];
-    if (isnan(temp)) {
-      snprintf(buffer, sizeof(buffer), "T: NaN H: ");
-    } else {
-      snprintf(buffer, sizeof(buffer), "T: %.1f", temp);
-    }
-    if (isnan(hum)) {
-      strcat(buffer, "NaN%");
-    } else {
-      char humBuf[16];
-      snprintf(humBuf, sizeof(humBuf), " H: %.1f%", hum);
-      strcat(buffer, humBuf);
-    }
-    u8x8.drawString(0, row, buffer);
+  // How long sampling can be stopped without delaying a read: 0 while a
+  // DHT capture is on the wire, else until the next sample is due.
+  uint32_t idleFor(uint32_t now) const {
+    if (dht.isCapturing()) return 0;
+    unsigned long interval = fastMode ? sampleIntervalFast : sampleIntervalSlow;
+    unsigned long since = now - lastSampleTime;
+    return since < interval ? interval - since : 0;
+  }
+
+  float getTemperature() const { return lastTemp; }
+  float getHumidity() const { return lastHum; }
+  // Bumped every time new averages are published.
+  uint16_t getUpdates() const { return updates; }
+
+  bool isDegraded() const { return tempHealth.isDegraded() || humHealth.isDegraded(); }
+  uint8_t getFaults() const { return tempHealth.getSeen() | humHealth.getSeen(); }
+  const SensorHealth &getTemperatureHealth() const { return tempHealth; }
+  const SensorHealth &getHumidityHealth() const { return humHealth; }
+  void resetHealth() {
+    tempHealth.reset();
+    humHealth.reset();
   }
 
-  void displayLast() {
-    display(lastTemp, lastHum);
+  const DHTStats &getReadStats() const { return dht.getStats(); }
+  void resetReadStats() {
+    dht.resetStats();
+    suspect = false;
+  }
+
+  // More than one frame in ten failing, or one in twenty decoding with a
+  // bit within 10 % of the 0/1 threshold: wiring, pull-up or the sensor is
+  // going, before the readings themselves go wrong.
+  bool readQualityPoor() const {
+    const DHTStats &s = dht.getStats();
+    if (s.attempts < qualityMinFrames) return false;
+    return (s.attempts - s.good) * 10 > s.attempts || s.margin[0] * 20 > s.attempts;
   }
 };
-DHT_Display dhtDisplay(DHTPIN, 2);
+ClimateSensor climate(DHTPIN);
 
 class WaterController {
 private:
-  SoilSensor &sensor;
-  RTCManager &rtc;
-  uint8_t pumpPin;
+  struct StoredDose {
+    uint16_t flowMlPerMin;
+    uint16_t doseMl;
+    uint16_t pulseMl;
+    uint16_t soakSec;
+    int16_t target;
+    uint8_t adaptive;
+  };
 
-  float threshold;
-  int maxPerWeek;
-  int waterCountThisWeek;
-  unsigned long lastPumpMillis;
-  bool pumping;
+  // One watering cycle of zone z: pulses of at most pulseMl, each followed
+  // by a soak, until doseMl is delivered or (adaptive) the target is met.
+  class DoseSequence : public Coroutine {
+  public:
+    WaterController *wc;
+    uint8_t z;
+    uint16_t totalMl;
+    uint16_t ml;
+    const char *reason;
+
+    bool step() override {
+      ZoneState &zones = wc->zones;
+      uint16_t bit = ZoneState::bit(z);
+      CO_BEGIN();
+      Log.printf("Zone %u: dosing %u ml\n", (unsigned)(z + 1), (unsigned)totalMl);
+      reason = "done";
+      while (zones.dosedMl[z] < totalMl) {
+        if ((zones.adaptive & bit) && zones.dosedMl[z] > 0 &&
+            (zones.valid & bit) && !zones.isSuspect(z) && zones.moisture[z] >= zones.target[z]) {
+          reason = "target reached";
+          break;
+        }
+        ml = totalMl - zones.dosedMl[z];
+        if (ml > zones.pulseMl[z]) ml = zones.pulseMl[z];
+        CO_WAIT_UNTIL(wc->power.request(z, zones.moisture[z], zones.mlToMs(z, ml)));
+        zones.waiting |= bit;
+        zones.inFlightMl[z] = ml;
+
+        CO_WAIT_EVENT(EVENT_PUMP_STOPPED(z), 0);
+        zones.dosedMl[z] += ml;
+        zones.inFlightMl[z] = 0;
+        if (zones.dosedMl[z] < totalMl) CO_SLEEP_FOR(zones.soakSec[z] * 1000UL);
+      }
+      zones.dosing &= ~bit;
+      Log.printf("Zone %u: %u ml, %s\n",
+                    (unsigned)(z + 1), (unsigned)zones.dosedMl[z], reason);
+      CO_END();
+    }
+  };
+
+  ZoneState &zones;
+  RTCManager &rtc;
+  PowerScheduler &power;
+  Scheduler &sequences;
+  DoseSequence dose[MAX_ZONES];
 
   uint8_t lastDOW;
-  int lastWaterHour;
-  int lastWaterDay;
-  int lastWaterMonth;
 
   unsigned long startTime;
   unsigned long warmUpDuration;
 
-  const unsigned long pumpDuration = 20000;
+  uint32_t calibrationRunMs[MAX_ZONES];
+
   const unsigned long minInterval  = 4UL * 3600UL * 1000UL;
 
 public:
-  WaterController(SoilSensor &s, RTCManager &r, uint8_t pinPump,
-                  float th, int maxW,
+  WaterController(ZoneState &z, RTCManager &r, PowerScheduler &p, Scheduler &s,
                   unsigned long warmUpSec = 10)
-      : sensor(s), rtc(r), pumpPin(pinPump),
-        threshold(th), maxPerWeek(maxW),
-        waterCountThisWeek(0), lastPumpMillis(0),
-        pumping(false), lastDOW(255),
-        lastWaterHour(-1), lastWaterDay(-1), lastWaterMonth(-1),
+      : zones(z), rtc(r), power(p), sequences(s), lastDOW(255),
         warmUpDuration(warmUpSec * 1000UL)
-  {}
+  {
+    memset(calibrationRunMs, 0, sizeof(calibrationRunMs));
+    for (uint8_t i = 0; i < MAX_ZONES; i++) {
+      dose[i].wc = this;
+      dose[i].z = i;
+    }
+  }
 
+  // Pumps are registered first, so actuator id == zone index.
   void begin() {
-    pinMode(pumpPin, OUTPUT);
-    digitalWrite(pumpPin, LOW);
+    for (uint8_t z = 0; z < zones.count; z++) {
+      power.addActuator(Pumps::writer(zones.pump[z]), zones.pumpMa[z]);
+      loadDose(z);
+    }
     startTime = millis();
   }
 
@@ -480,49 +777,327 @@ public:
 
     if (now.dow != lastDOW) {
         lastDOW = now.dow;
-        if (now.dow == 1) waterCountThisWeek = 0;
+        if (now.dow == 1) memset(zones.waterCount, 0, sizeof(zones.waterCount));
+    }
+
+    unsigned long ms = millis();
+    for (uint8_t z = 0; z < zones.count; z++) {
+      uint16_t bit = ZoneState::bit(z);
+      trackPump(z);
+
+      if ((zones.dosing | zones.pumping | zones.waiting) & bit) continue;
+
+      if (!(zones.valid & bit)) continue;
+      if (zones.isSuspect(z)) continue;   // probe failed its checks, see SensorHealth
+      if (zones.moisture[z] > zones.threshold[z]) continue;
+      if ((zones.watered & bit) && ms - zones.pumpStart[z] < minInterval) continue;
+      if (zones.waterCount[z] >= zones.maxPerWeek[z]) continue;
+
+      startDose(z, ms);
+      zones.waterCount[z]++;
+    }
+  }
+
+  // Manual or rule-triggered dose, outside the weekly limit; ml = 0 uses
+  // the zone's configured dose.
+  bool doseNow(uint8_t z, uint16_t ml = 0) {
+    if ((zones.dosing | zones.pumping | zones.waiting) & ZoneState::bit(z)) return false;
+    startDose(z, millis(), ml);
+    return true;
+  }
+
+  // Runs pump z for a fixed time; measure the water and pass it to
+  // finishCalibration() to get the flow rate.
+  bool runCalibration(uint8_t z, uint32_t durationMs) {
+    if ((zones.dosing | zones.pumping | zones.waiting) & ZoneState::bit(z)) return false;
+    if (!power.request(z, INT16_MIN, durationMs)) return false;
+    zones.waiting |= ZoneState::bit(z);
+    calibrationRunMs[z] = durationMs;
+    return true;
+  }
+
+  bool finishCalibration(uint8_t z, uint16_t measuredMl) {
+    if (calibrationRunMs[z] == 0 || measuredMl == 0) return false;
+    zones.flowMlPerMin[z] = (uint16_t)((uint32_t)measuredMl * 60000UL / calibrationRunMs[z]);
+    calibrationRunMs[z] = 0;
+    return true;
+  }
+
+  bool saveDose(uint8_t z) const {
+    StoredDose d = {zones.flowMlPerMin[z], zones.doseMl[z], zones.pulseMl[z],
+                    zones.soakSec[z], zones.target[z],
+                    (uint8_t)((zones.adaptive & ZoneState::bit(z)) ? 1 : 0)};
+    char key[8];
+    snprintf(key, sizeof(key), "z%u", (unsigned)(z + 1));
+    Preferences prefs;
+    prefs.begin("dosing", false);
+    bool ok = prefs.putBytes(key, &d, sizeof(d)) == sizeof(d);
+    prefs.end();
+    return ok;
+  }
+
+private:
+  void loadDose(uint8_t z) {
+    StoredDose d;
+    char key[8];
+    snprintf(key, sizeof(key), "z%u", (unsigned)(z + 1));
+    Preferences prefs;
+    prefs.begin("dosing", true);
+    if (prefs.getBytesLength(key) == sizeof(d) &&
+        prefs.getBytes(key, &d, sizeof(d)) == sizeof(d) && d.flowMlPerMin > 0) {
+      zones.flowMlPerMin[z] = d.flowMlPerMin;
+      zones.doseMl[z] = d.doseMl;
+      zones.pulseMl[z] = d.pulseMl ? d.pulseMl : d.doseMl;
+      zones.soakSec[z] = d.soakSec;
+      zones.target[z] = d.target;
+      if (d.adaptive) zones.adaptive |= ZoneState::bit(z);
+      else zones.adaptive &= ~ZoneState::bit(z);
     }
+    prefs.end();
+  }
 
-    if (pumping) {
-        if (millis() - lastPumpMillis >= pumpDuration) stopPump();
-        return;
+  void startDose(uint8_t z, unsigned long ms, uint16_t ml = 0) {
+    uint16_t bit = ZoneState::bit(z);
+    dose[z].totalMl = ml ? ml : zones.doseMl[z];
+    zones.dosing |= bit;
+    zones.watered |= bit;
+    zones.pumpStart[z] = ms;
+    zones.dosedMl[z] = 0;
+    zones.inFlightMl[z] = 0;
+    if (!sequences.start(dose[z])) {
+      zones.dosing &= ~bit;
+      Log.printf("Zone %u: no free sequence, dose skipped\n", (unsigned)(z + 1));
     }
+  }
 
-    float moisture = sensor.getLatestMoisture();
-    if (isnan(moisture)) return;
+  // Mirrors the scheduler's view of pump z into the zone flags and tells
+  // the dose sequence when a pulse ends.
+  void trackPump(uint8_t z) {
+    uint16_t bit = ZoneState::bit(z);
+    bool on = power.isRunning(z);
+
+    if (on && !(zones.pumping & bit)) {
+      zones.pumping |= bit;
+      zones.waiting &= ~bit;
+      Log.printf("Pump %u START\n", (unsigned)(z + 1));
+    } else if (!on && (zones.pumping & bit)) {
+      zones.pumping &= ~bit;
+      Log.printf("Pump %u STOP\n", (unsigned)(z + 1));
+      sequences.signal(EVENT_PUMP_STOPPED(z));
+    }
+  }
+};
 
-    if (moisture > threshold) return;
+// Feeds the history log (one frame of climate and moisture per minute,
+// plus a watering event whenever a dose cycle ends) and the in-RAM
+// rollups (every new reading as it is published).
+class HistoryRecorder {
+private:
+  TimeSeriesLog &log;
+  Rollup &rollup;
+  ZoneState &zones;
+  ClimateSensor &dht;
+  RTCManager &rtc;
 
-    if (lastWaterHour >= 0) {
-        unsigned long elapsed = millis() - lastPumpMillis;
-        if (elapsed < minInterval) return;
+  unsigned long lastSample;
+  uint16_t lastDosing;
+  uint16_t lastDhtUpdate;
+  uint32_t lastReadingAt[MAX_ZONES];
+
+  void updateRollups() {
+    uint32_t t = 0;
+    if (dht.getUpdates() != lastDhtUpdate) {
+      lastDhtUpdate = dht.getUpdates();
+      t = rtc.getEpoch();
+      if (!isnan(dht.getTemperature())) rollup.add(SERIES_TEMPERATURE, t, lroundf(dht.getTemperature() * 10.0f));
+      if (!isnan(dht.getHumidity())) rollup.add(SERIES_HUMIDITY, t, lroundf(dht.getHumidity() * 10.0f));
     }
+    for (uint8_t z = 0; z < zones.count; z++) {
+      if (!zones.isValid(z) || zones.isSuspect(z) || zones.readingAt[z] == lastReadingAt[z]) continue;
+      lastReadingAt[z] = zones.readingAt[z];
+      if (t == 0) t = rtc.getEpoch();
+      rollup.add(SERIES_MOISTURE(z), t, zones.moisture[z]);
+    }
+  }
 
-    if (waterCountThisWeek >= maxPerWeek) return;
+  const unsigned long sampleInterval = 60000;
 
-    startPump();
-    waterCountThisWeek++;
-    lastWaterHour = now.hour;
-    lastWaterDay = now.day;
-    lastWaterMonth = now.month;
+public:
+  HistoryRecorder(TimeSeriesLog &l, Rollup &ru, ZoneState &z, ClimateSensor &d, RTCManager &r)
+    : log(l), rollup(ru), zones(z), dht(d), rtc(r),
+      lastSample(0), lastDosing(0), lastDhtUpdate(0) {
+    memset(lastReadingAt, 0, sizeof(lastReadingAt));
+  }
 
-}
+  void begin() {
+    if (!log.begin()) {
+      Log.println("History partition missing, not logging");
+      return;
+    }
+    Log.printf("History: %u pages\n", (unsigned)log.getPageCount());
+    lastSample = millis() - sampleInterval;
+  }
+
+  void update() {
+    updateRollups();
+
+    if (!log.isReady()) return;
+    int32_t values[TSLOG_MAX_SERIES];
+
+    uint16_t finished = lastDosing & ~zones.dosing;
+    lastDosing = zones.dosing;
+    if (finished) {
+      uint32_t t = rtc.getEpoch();
+      for (uint8_t z = 0; z < zones.count; z++) {
+        if (!(finished & ZoneState::bit(z))) continue;
+        values[SERIES_WATERING] = ((int32_t)z << 16) | zones.dosedMl[z];
+        log.append(t, 1UL << SERIES_WATERING, values);
+      }
+    }
+
+    unsigned long now = millis();
+    if (now - lastSample < sampleInterval) return;
+    lastSample = now;
+
+    uint32_t mask = 0;
+    float t = dht.getTemperature();
+    float h = dht.getHumidity();
+    if (!isnan(t)) { values[SERIES_TEMPERATURE] = lroundf(t * 10.0f); mask |= 1UL << SERIES_TEMPERATURE; }
+    if (!isnan(h)) { values[SERIES_HUMIDITY] = lroundf(h * 10.0f); mask |= 1UL << SERIES_HUMIDITY; }
+    for (uint8_t z = 0; z < zones.count; z++) {
+      if (!zones.isValid(z) || zones.isSuspect(z)) continue;
+      values[SERIES_MOISTURE(z)] = zones.moisture[z];
+      mask |= 1UL << SERIES_MOISTURE(z);
+    }
+    if (mask) log.append(rtc.getEpoch(), mask, values);
+  }
+};
+
+// Copies the controllers' state into the shared snapshot. Readers (menu,
+// console) never touch the controllers themselves.
+class StatePublisher {
+private:
+  Seqlock<SystemState> &out;
+  ZoneState &zones;
+  SoilSensorBank &soil;
+  ClimateSensor &dht;
+  PowerScheduler &power;
+  Rollup &rollup;
+  RTCManager &rtc;
+
+  SystemState state;
+  unsigned long lastPublish;
+  uint16_t rangeGeneration;
+
+  const unsigned long publishInterval = 100;
 
-  int getWaterCountThisWeek() const { return waterCountThisWeek; }
-  int getMaxPerWeek() const { return maxPerWeek; }
+  void updateRanges() {
+    uint32_t to = rollup.getNewest();
+    for (uint8_t z = 0; z < zones.count; z++) {
+      Rollup::Result r = rollup.query(SERIES_MOISTURE(z), to - 86400UL, to);
+      state.dayMin[z] = r.min;
+      state.dayMax[z] = r.max;
+      state.daySamples[z] = r.count > UINT16_MAX ? UINT16_MAX : r.count;
+    }
+  }
+
+public:
+  StatePublisher(Seqlock<SystemState> &o, ZoneState &z, SoilSensorBank &s, ClimateSensor &d,
+                 PowerScheduler &p, Rollup &ru, RTCManager &r)
+    : out(o), zones(z), soil(s), dht(d), power(p), rollup(ru), rtc(r),
+      lastPublish(0), rangeGeneration(0) {
+    memset(&state, 0, sizeof(state));
+  }
 
+  void update() {
+    unsigned long now = millis();
+    if (now - lastPublish < publishInterval) return;
+    lastPublish = now;
+
+    state.publishedAt = now;
+    state.epoch = rtc.getEpoch();
+    state.temperature = dht.getTemperature();
+    state.humidity = dht.getHumidity();
+    state.climateUpdates = dht.getUpdates();
+    state.climateFaults = dht.getFaults();
+    state.climateDegraded = dht.isDegraded();
+
+    state.zoneCount = zones.count;
+    state.soilGeneration = soil.getGeneration();
+    state.valid = zones.valid;
+    state.uncalibrated = zones.uncalibrated;
+    state.pumping = zones.pumping;
+    state.waiting = zones.waiting;
+    state.dosing = zones.dosing;
+    state.degraded = zones.degraded;
+    memcpy(state.faults, zones.faults, sizeof(state.faults));
+    memcpy(state.millivolts, zones.millivolts, sizeof(state.millivolts));
+    memcpy(state.noiseMv, zones.noiseMv, sizeof(state.noiseMv));
+    memcpy(state.moisture, zones.moisture, sizeof(state.moisture));
+    memcpy(state.threshold, zones.threshold, sizeof(state.threshold));
+    memcpy(state.waterCount, zones.waterCount, sizeof(state.waterCount));
+    memcpy(state.maxPerWeek, zones.maxPerWeek, sizeof(state.maxPerWeek));
+    if (state.soilGeneration != rangeGeneration) {
+      rangeGeneration = state.soilGeneration;
+      updateRanges();
+    }
+
+    state.usedMa = power.getUsedMa();
+    state.budgetMa = power.getBudgetMa();
+    state.queueLength = power.getQueueLength();
+
+    out.write(state);
+  }
+};
+
+// Feeds the rule engine from each new snapshot and runs the rules whose
+// inputs changed.
+class RuleRunner {
 private:
-  void startPump() {
-    pumping = true;
-    lastPumpMillis = millis();
-    digitalWrite(pumpPin, HIGH);
-    Serial.println("Pump START");
+  RuleEngine &engine;
+  const Seqlock<SystemState> &state;
+  uint32_t lastSequence;
+
+public:
+  RuleRunner(RuleEngine &e, const Seqlock<SystemState> &s)
+    : engine(e), state(s), lastSequence(0) {}
+
+  // Compiles the stored rules.
+  void begin() {
+    char text[RULE_TEXT_SIZE];
+    for (uint8_t i = 0; i < RULE_MAX && RuleEngine::loadText(i, text, sizeof(text)); i++) {
+      Rule r;
+      const char *error;
+      if (!RuleEngine::compile(text, r, error)) {
+        Log.printf("Rule %u: %s\n", (unsigned)(i + 1), error);
+        r.length = 0;   // keep the slot so numbering matches storage
+        r.deps = 0;
+      }
+      engine.add(r);
+    }
+    if (engine.size()) Log.printf("%u rules loaded\n", (unsigned)engine.size());
   }
 
-  void stopPump() {
-    pumping = false;
-    digitalWrite(pumpPin, LOW);
-    Serial.println("Pump STOP");
+  void update() {
+    uint32_t seq = state.getSequence();
+    if (seq == lastSequence) return;
+    lastSequence = seq;
+
+    SystemState s;
+    state.read(s);
+    Ds1302::DateTime now;
+    RTCManager::fromEpoch(s.epoch, now);
+    engine.setInput(RULE_IN_TEMPERATURE, s.temperature);
+    engine.setInput(RULE_IN_HUMIDITY, s.humidity);
+    engine.setInput(RULE_IN_VPD, Psychrometrics::vpd(s.temperature, s.humidity));
+    engine.setInput(RULE_IN_DEWPOINT, Psychrometrics::dewPoint(s.temperature, s.humidity));
+    engine.setInput(RULE_IN_HOUR, now.hour);
+    engine.setInput(RULE_IN_MINUTE, now.minute);
+    engine.setInput(RULE_IN_DOW, now.dow);
+    for (uint8_t z = 0; z < s.zoneCount; z++) {
+      engine.setInput(RULE_IN_MOISTURE(z), s.faults[z] ? NAN : s.moisturePct(z));
+    }
+    engine.evaluate();
   }
 };
 
@@ -537,40 +1112,44 @@ public:
 
 private:
   U8X8_SSD1306_128X64_NONAME_HW_I2C &display;
-  DHT_Display &dhtDisplay;
   Mode currentMode;
   const char **menuItems;
   int menuSize;
   int cursorIndex;
   uint8_t lastSecond;
-  SoilSensor &sensor1;
-  SoilSensor &sensor2;
-  unsigned long lastSoilUpdate = 0;
-  unsigned long lastSoilDisplay = 0;
-  WaterController &wc1;
-  WaterController &wc2;
+  const Seqlock<SystemState> &state;
+  SystemState snap;
+  uint16_t shownGeneration = 0;
+  uint16_t shownClimate = 0;
+  uint32_t shownEpoch = 0;
+  uint8_t rangeZone = 0;
+  uint8_t alertItem = 0;
+  unsigned long lastRangeFlip = 0;
+  bool zonesDirty = true;
+  uint8_t zonePage = 0;
+  unsigned long lastPageFlip = 0;
+
+  static const uint8_t ZONE_ROWS = 4;          // rows 3..6
+  static const unsigned long PAGE_MS = 5000;
 
 public:
   MenuSystem(U8X8_SSD1306_128X64_NONAME_HW_I2C &u8x8,
-          DHT_Display &dht,
           const char* items[], int size,
-          SoilSensor &s1, SoilSensor &s2,
-          WaterController &w1, WaterController &w2)
+          const Seqlock<SystemState> &st)
     : display(u8x8),
-      dhtDisplay(dht),
       currentMode(DATA_MODE),
       menuItems(items),
       menuSize(size),
       cursorIndex(0),
       lastSecond(255),
-      sensor1(s1), 
-      sensor2(s2),
-      wc1(w1),
-      wc2(w2)
-  {}
+      state(st)
+  {
+    memset(&snap, 0, sizeof(snap));
+  }
+  // On the data screen, which only redraws on its own.
+  bool isIdle() const { return currentMode == DATA_MODE; }
+
   void begin() {
-    sensor1.begin();
-    sensor2.begin();
     if (currentMode == DATA_MODE) {
       drawModeScreen(DATA_MODE);
     } else {
@@ -579,6 +1158,7 @@ public:
   }
 
   void update(bool btn1, bool btn2, bool btn3, bool btn4) {
+    state.read(snap);
     switch (currentMode) {
       case MAIN_MENU:
         handleMainMenu(btn1, btn2, btn3);
@@ -610,6 +1190,7 @@ private:
 
   void drawModeScreen(Mode m) {
     display.clear();
+    zonesDirty = true;
     switch (m) {
       case DATA_MODE: display.drawString(0, 0, "      Data"); break;
       case SETTIME_MODE: display.drawString(0, 0, "    Set Time"); break;
@@ -618,9 +1199,8 @@ private:
   }
 
   void handleMainMenu(bool btn1, bool btn2, bool btn3) {
-    dhtDisplay.update(false);
     Ds1302::DateTime now;
-    rtcManager.getDateTime(now);
+    RTCManager::fromEpoch(snap.epoch, now);
     char buf[11];
     snprintf(buf, sizeof(buf), "20%02d/%02d/%02d", now.year, now.month, now.day);
     display.drawString(16, 7, buf);
@@ -639,7 +1219,7 @@ private:
           currentMode = DATA_MODE; 
           break;
         case 1: 
-          rtcManager.getDateTime(timeSnapshot);
+          RTCManager::fromEpoch(snap.epoch, timeSnapshot);
           currentMode = SETTIME_MODE;
           break;
         case 2: 
@@ -652,31 +1232,20 @@ private:
 
   void handleDataMode(bool btn4) {
 
-    char buf[17];
-    if (rtcManager.getFormattedMonthDayTime(buf, sizeof(buf))) {
-        display.drawString(0, 1, buf);
+    if (zonesDirty || snap.epoch != shownEpoch) {
+      shownEpoch = snap.epoch;
+      Ds1302::DateTime now;
+      RTCManager::fromEpoch(snap.epoch, now);
+      char buf[17];
+      snprintf(buf, sizeof(buf), "%02d/%02d %02d:%02d:%02d",
+               now.month, now.day, now.hour, now.minute, now.second);
+      display.drawString(0, 1, buf);
     }
 
-    dhtDisplay.update(true);
-    dhtDisplay.displayLast();
+    drawClimate();
 
-    sensor1.update(true);
-    sensor2.update(true);
-
-    sensor1.displayLast();
-    sensor2.displayLast();
-
-    char waterInfo1[20];
-    char waterInfo2[20];
-
-    snprintf(waterInfo1, sizeof(waterInfo1), "M1: %d (%d 20s)", 
-           wc1.getWaterCountThisWeek(), wc1.getMaxPerWeek());
-  
-    snprintf(waterInfo2, sizeof(waterInfo2), "M2: %d (%d 20s)", 
-            wc2.getWaterCountThisWeek(), wc2.getMaxPerWeek());
-    
-    display.drawString(0, 5, waterInfo1);
-    display.drawString(0, 6, waterInfo2);
+    drawRange();
+    drawZones();
 
     if (btn4) {
         currentMode = MAIN_MENU;
@@ -685,6 +1254,114 @@ private:
     }
   }
 
+  // Zone lines on rows 3..6, paging every 5 s when there are more zones
+  // than rows. Only redrawn when new readings arrive or the page flips.
+  void drawZones() {
+    unsigned long now = millis();
+    bool redraw = zonesDirty || snap.soilGeneration != shownGeneration;
+    if (snap.zoneCount > ZONE_ROWS && now - lastPageFlip >= PAGE_MS) {
+      lastPageFlip = now;
+      zonePage = (zonePage + ZONE_ROWS < snap.zoneCount) ? zonePage + ZONE_ROWS : 0;
+      redraw = true;
+    }
+    if (!redraw) return;
+    shownGeneration = snap.soilGeneration;
+    zonesDirty = false;
+
+    for (uint8_t row = 0; row < ZONE_ROWS; row++) {
+      uint8_t z = zonePage + row;
+      char buf[LINE_WIDTH + 1];
+      if (z < snap.zoneCount) {
+        if (snap.faults[z]) {
+          snprintf(buf, sizeof(buf), "M%-2u !%-5s  %u/%u",
+                   (unsigned)(z + 1), SensorHealth::name(snap.faults[z]),
+                   (unsigned)snap.waterCount[z], (unsigned)snap.maxPerWeek[z]);
+        } else if (snap.isValid(z)) {
+          snprintf(buf, sizeof(buf), "M%-2u%5.1f%% %u/%u%c",
+                   (unsigned)(z + 1), snap.moisturePct(z),
+                   (unsigned)snap.waterCount[z], (unsigned)snap.maxPerWeek[z],
+                   snap.isPumping(z) ? '*' : snap.isWaiting(z) ? '+' :
+                   snap.isDosing(z) ? '~' : ' ');
+        } else if (snap.isUncalibrated(z)) {
+          snprintf(buf, sizeof(buf), "M%-2u uncal %u/%u ",
+                   (unsigned)(z + 1),
+                   (unsigned)snap.waterCount[z], (unsigned)snap.maxPerWeek[z]);
+        } else {
+          snprintf(buf, sizeof(buf), "M%-2u  --.-%% %u/%u ",
+                   (unsigned)(z + 1),
+                   (unsigned)snap.waterCount[z], (unsigned)snap.maxPerWeek[z]);
+        }
+      } else {
+        buf[0] = '\0';
+      }
+      size_t len = strlen(buf);
+      memset(buf + len, ' ', LINE_WIDTH - len);
+      buf[LINE_WIDTH] = '\0';
+      display.drawString(0, 3 + row, buf);
+    }
+  }
+
+  // Row 2: the latest 5 s climate averages.
+  void drawClimate() {
+    if (!zonesDirty && snap.climateUpdates == shownClimate) return;
+    shownClimate = snap.climateUpdates;
+
+    char buffer[32];
+    if (isnan(snap.temperature)) {
+      snprintf(buffer, sizeof(buffer), "T: NaN H: ");
+    } else {
+      snprintf(buffer, sizeof(buffer), "T: %.1f", snap.temperature);
+    }
+    if (isnan(snap.humidity)) {
+      strcat(buffer, "NaN%");
+    } else {
+      char humBuf[16];
+      snprintf(humBuf, sizeof(humBuf), " H: %.1f%%", snap.humidity);
+      strcat(buffer, humBuf);
+    }
+    display.drawString(0, 2, buffer);
+  }
+
+  // Next degraded sensor after alertItem, cycling through the zones and
+  // then the DHT (item zoneCount); false if none is.
+  bool nextAlert() {
+    for (uint8_t i = 0; i <= snap.zoneCount; i++) {
+      alertItem = alertItem < snap.zoneCount ? alertItem + 1 : 0;
+      if (alertItem == snap.zoneCount ? snap.climateDegraded : snap.isDegraded(alertItem)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Row 7: last 24 h moisture range, one zone at a time, or an alert for
+  // each degraded sensor while there are any.
+  void drawRange() {
+    unsigned long now = millis();
+    if (!zonesDirty && now - lastRangeFlip < PAGE_MS) return;
+    lastRangeFlip = now;
+    rangeZone = (rangeZone + 1 < snap.zoneCount) ? rangeZone + 1 : 0;
+
+    char buf[LINE_WIDTH + 1];
+    if (nextAlert()) {
+      if (alertItem == snap.zoneCount) {
+        snprintf(buf, sizeof(buf), "!FAULT DHT %s", SensorHealth::name(snap.climateFaults));
+      } else {
+        snprintf(buf, sizeof(buf), "!FAULT M%u %s", (unsigned)(alertItem + 1),
+                 SensorHealth::name(snap.faults[alertItem]));
+      }
+    } else if (snap.daySamples[rangeZone] > 0) {
+      snprintf(buf, sizeof(buf), "M%-2u24h %4.1f-%4.1f", (unsigned)(rangeZone + 1),
+               snap.dayMin[rangeZone] * 0.1f, snap.dayMax[rangeZone] * 0.1f);
+    } else {
+      snprintf(buf, sizeof(buf), "M%-2u24h  --", (unsigned)(rangeZone + 1));
+    }
+    size_t len = strlen(buf);
+    memset(buf + len, ' ', LINE_WIDTH - len);
+    buf[LINE_WIDTH] = '\0';
+    display.drawString(0, 7, buf);
+  }
+
   void handleSetTimeModes(bool btn1, bool btn2, bool btn3, bool btn4) {
     static int editIndex = 0;
 
@@ -752,7 +1429,12 @@ private:
     display.drawString(0, 2, bufTime);
 
     if (btn4) {
-        rtcManager.setDateTime(timeSnapshot);
+        // The RTC belongs to the control task; hand it the new time.
+        ConsoleLine cmd;
+        snprintf(cmd.text, sizeof(cmd.text), "time %u %u %u %u %u %u",
+                 timeSnapshot.year, timeSnapshot.month, timeSnapshot.day,
+                 timeSnapshot.hour, timeSnapshot.minute, timeSnapshot.second);
+        commandLines.push(cmd);
         editIndex = 0;
         currentMode = MAIN_MENU;
         cursorIndex = 0;
@@ -762,24 +1444,441 @@ private:
 
 };
 
-Button btn1(BUTTON1_PIN, BUTTON_PULSE);
-Button btn2(BUTTON2_PIN, BUTTON_PULSE);
-Button btn3(BUTTON3_PIN, BUTTON_PULSE);
-Button btn4(BUTTON4_PIN, BUTTON_PULSE);
+ButtonInput buttons;
 
-SoilSensor sensor1(PIN_SOILSENSOR_1, 3, u8x8);
-SoilSensor sensor2(PIN_SOILSENSOR_2, 4, u8x8);
+ZoneState zones;
+#ifdef PIN_MUX_S0
+// Select lines of the CD74HC4067 for zones declared with a mux channel.
+const uint8_t muxSelectPins[4] = {PIN_MUX_S0, PIN_MUX_S1, PIN_MUX_S2, PIN_MUX_S3};
+SoilSensorBank soil(zones, SoilPower::write, muxSelectPins);
+#else
+SoilSensorBank soil(zones, SoilPower::write);
+#endif
+DryingEstimator drying(zones);
+PowerScheduler power(POWER_BUDGET_MA, POWER_SOFTSTART_MS);
+TimeSeriesLog historyLog;
+Rollup rollup;
+HistoryRecorder history(historyLog, rollup, zones, climate, rtcManager);
+Scheduler sequences;
+WaterController water(zones, rtcManager, power, sequences, 10);
+
+Seqlock<SystemState> systemState;
+StatePublisher publisher(systemState, zones, soil, climate, power, rollup, rtcManager);
+RuleEngine rules;
+RuleRunner ruleRunner(rules, systemState);
+MenuSystem menu(u8x8, menuItems, menuSize, systemState);
 
-WaterController wc1(sensor1, rtcManager, PUMP_PIN_1, 20.0, 5, 10);
-WaterController wc2(sensor2, rtcManager, PUMP_PIN_2, 30.0, 5, 10);
+void clearLine(uint8_t row);
 
-MenuSystem menu(u8x8, dhtDisplay, menuItems, menuSize, sensor1, sensor2, wc1, wc2);
+// Zones are numbered from 1 on the console and the display.
+int parseZone(const char *arg) {
+  int id = atoi(arg);
+  if (id < 1 || id > zones.count) {
+    Log.print("Unknown zone: ");
+    Log.println(arg);
+    return -1;
+  }
+  return id - 1;
+}
 
-void clearLine(uint8_t row);
+void cmdCalibrate(int argc, char **argv) {
+  if (argc < 3) {
+    Log.println("Usage: cal <zone> show|add <pct>|set <mV> <pct>|clear|save|reset");
+    return;
+  }
+  int z = parseZone(argv[1]);
+  if (z < 0) return;
+  SoilCalibration &cal = soil.getCalibration(z);
+  uint8_t id = z + 1;
+
+  if (strcmp(argv[2], "show") == 0) {
+    Log.printf("Zone %u: now %u mV, %u points\n",
+                  (unsigned)id, (unsigned)zones.millivolts[z], (unsigned)cal.size());
+    for (uint8_t i = 0; i < cal.size(); i++) {
+      Log.printf("  %u mV -> %.1f%%\n",
+                    (unsigned)cal.pointMv(i), cal.pointPermille(i) * 0.1f);
+    }
+  } else if (strcmp(argv[2], "add") == 0 && argc >= 4) {
+    if (!zones.readingAt[z]) {
+      Log.println("No reading yet, wait for the next update");
+      return;
+    }
+    int16_t permille = (int16_t)(atof(argv[3]) * 10.0f);
+    if (!cal.addPoint(zones.millivolts[z], permille)) {
+      Log.println("Calibration table full");
+      return;
+    }
+    Log.printf("Added %u mV -> %.1f%%\n", (unsigned)zones.millivolts[z], permille * 0.1f);
+  } else if (strcmp(argv[2], "set") == 0 && argc >= 5) {
+    int16_t permille = (int16_t)(atof(argv[4]) * 10.0f);
+    if (!cal.addPoint((uint16_t)atoi(argv[3]), permille)) {
+      Log.println("Calibration table full");
+    }
+  } else if (strcmp(argv[2], "clear") == 0) {
+    cal.clear();
+    Log.println("Table cleared, zone uncalibrated until 2 points are added");
+  } else if (strcmp(argv[2], "save") == 0) {
+    Log.println(cal.save(id) ? "Calibration saved" : "Need at least 2 points");
+  } else if (strcmp(argv[2], "reset") == 0) {
+    SoilCalibration::erase(id);
+    cal.setDefault();
+    Log.println("Calibration reset to default model");
+  } else {
+    Log.println("Usage: cal <zone> show|add <pct>|set <mV> <pct>|clear|save|reset");
+  }
+  soil.recalibrated(z);
+}
+
+void cmdZones(int argc, char **argv) {
+  SystemState s;
+  unsigned long t0 = micros();
+  systemState.read(s);
+  unsigned long us = micros() - t0;
+  for (uint8_t z = 0; z < s.zoneCount; z++) {
+    Log.printf("Zone %u: %4u mV +-%-3u %5.1f%%  threshold %.1f%%  watered %u/%u%s\n",
+                  (unsigned)(z + 1), (unsigned)s.millivolts[z],
+                  (unsigned)s.noiseMv[z], s.moisturePct(z), s.threshold[z] * 0.1f,
+                  (unsigned)s.waterCount[z], (unsigned)s.maxPerWeek[z],
+                  s.isPumping(z) ? "  pumping" : s.isWaiting(z) ? "  queued" :
+                  s.isDosing(z) ? "  soaking" : s.isUncalibrated(z) ? "  uncalibrated" : "");
+  }
+  Log.printf("Snapshot %lu ms old, read in %lu us\n",
+                (unsigned long)(millis() - s.publishedAt), us);
+}
+
+void cmdDose(int argc, char **argv) {
+  const char *usage =
+      "Usage: dose <zone> [now|set <ml> [pulse ml] [soak s]|adaptive on|off [target %]|"
+      "calrun <s>|calml <ml>|save]";
+  if (argc < 2) {
+    Log.println(usage);
+    return;
+  }
+  int z = parseZone(argv[1]);
+  if (z < 0) return;
+
+  if (argc == 2) {
+    // fall through to the summary below
+  } else if (strcmp(argv[2], "now") == 0) {
+    if (!water.doseNow(z)) Log.println("Zone busy");
+  } else if (strcmp(argv[2], "set") == 0 && argc >= 4) {
+    zones.doseMl[z] = (uint16_t)atoi(argv[3]);
+    zones.pulseMl[z] = argc >= 5 ? (uint16_t)atoi(argv[4]) : zones.doseMl[z];
+    if (argc >= 6) zones.soakSec[z] = (uint16_t)atoi(argv[5]);
+    if (zones.pulseMl[z] == 0) zones.pulseMl[z] = zones.doseMl[z];
+  } else if (strcmp(argv[2], "adaptive") == 0 && argc >= 4) {
+    if (strcmp(argv[3], "on") == 0) zones.adaptive |= ZoneState::bit(z);
+    else zones.adaptive &= ~ZoneState::bit(z);
+    if (argc >= 5) zones.target[z] = (int16_t)(atof(argv[4]) * 10.0f);
+  } else if (strcmp(argv[2], "calrun") == 0 && argc >= 4) {
+    uint32_t ms = (uint32_t)atoi(argv[3]) * 1000UL;
+    if (ms == 0 || !water.runCalibration(z, ms)) {
+      Log.println("Zone busy");
+      return;
+    }
+    Log.println("Pump running, then enter: dose <zone> calml <measured ml>");
+    return;
+  } else if (strcmp(argv[2], "calml") == 0 && argc >= 4) {
+    if (!water.finishCalibration(z, (uint16_t)atoi(argv[3]))) {
+      Log.println("Run 'dose <zone> calrun <s>' first");
+      return;
+    }
+  } else if (strcmp(argv[2], "save") == 0) {
+    Log.println(water.saveDose(z) ? "Dosing saved" : "Save failed");
+    return;
+  } else {
+    Log.println(usage);
+    return;
+  }
+
+  Log.printf("Zone %u: %u ml in %u ml pulses, soak %u s, flow %u ml/min, adaptive %s (target %.1f%%)\n",
+                (unsigned)(z + 1), (unsigned)zones.doseMl[z], (unsigned)zones.pulseMl[z],
+                (unsigned)zones.soakSec[z], (unsigned)zones.flowMlPerMin[z],
+                (zones.adaptive & ZoneState::bit(z)) ? "on" : "off", zones.target[z] * 0.1f);
+}
+
+void cmdPredict(int argc, char **argv) {
+  uint32_t now = millis();
+  Log.printf("%u sensor wake-ups so far, probes powered %lu ms in total (last %lu us)\n",
+             (unsigned)soil.getGeneration(), (unsigned long)(soil.getTotalOnTime() / 1000),
+             (unsigned long)soil.getLastOnTime());
+  for (uint8_t z = 0; z < zones.count; z++) {
+    float hours = drying.hoursToThreshold(z);
+    Log.printf("Zone %u: %+.2f %%/h (%u fits), threshold in %s%.1f h, next check in %lu s\n",
+                  (unsigned)(z + 1), drying.predictedRate(z), (unsigned)drying.getUpdates(z),
+                  isnan(hours) ? "? " : "", isnan(hours) ? 0.0f : hours,
+                  (unsigned long)((int32_t)(zones.nextCheck[z] - now) > 0 ? (zones.nextCheck[z] - now) / 1000UL : 0));
+  }
+}
+
+void cmdLog(int argc, char **argv) {
+  if (!historyLog.isReady()) {
+    Log.println("History partition missing");
+    return;
+  }
+  if (argc >= 2 && strcmp(argv[1], "flush") == 0) {
+    historyLog.flush();
+  } else if (argc >= 3 && strcmp(argv[1], "dump") == 0) {
+    uint32_t to = rtcManager.getEpoch();
+    uint32_t from = to - (uint32_t)atoi(argv[2]) * 60UL;
+    historyLog.scan(from, to, [](uint32_t t, uint8_t series, int32_t value) {
+      Log.printf("%lu %u %ld\n", (unsigned long)t, (unsigned)series, (long)value);
+    });
+    return;
+  } else if (argc != 1) {
+    Log.println("Usage: log [flush|dump <minutes>]");
+    return;
+  }
+  Log.printf("History: %u pages, %lu written, %u frames / %u bytes buffered\n",
+                (unsigned)historyLog.getPageCount(), (unsigned long)historyLog.getPagesWritten(),
+                (unsigned)historyLog.getBufferedFrames(), (unsigned)historyLog.getBufferedBytes());
+  if (historyLog.getWriteErrors() || historyLog.getDropped()) {
+    Log.printf("History: %lu write errors, %lu frames dropped\n",
+                  (unsigned long)historyLog.getWriteErrors(), (unsigned long)historyLog.getDropped());
+  }
+}
+
+// "now"/"0", or a time ago with an m/h/d suffix, e.g. "24h".
+bool parseAgo(const char *arg, uint32_t now, uint32_t &t) {
+  if (strcmp(arg, "now") == 0) { t = now; return true; }
+  char *end;
+  unsigned long n = strtoul(arg, &end, 10);
+  uint32_t unit = 60;
+  if (*end == 'h') unit = 3600;
+  else if (*end == 'd') unit = 86400;
+  else if (*end != 'm' && *end != '\0') return false;
+  t = now - n * unit;
+  return true;
+}
+
+void cmdHistory(int argc, char **argv) {
+  const char *usage = "Usage: history <zone|t|h> <from> <to> min|max|avg|count  (e.g. history 1 24h now max)";
+  if (argc < 5) {
+    Log.println(usage);
+    return;
+  }
+  uint8_t series;
+  if (strcmp(argv[1], "t") == 0) series = SERIES_TEMPERATURE;
+  else if (strcmp(argv[1], "h") == 0) series = SERIES_HUMIDITY;
+  else {
+    int z = parseZone(argv[1]);
+    if (z < 0) return;
+    series = SERIES_MOISTURE(z);
+  }
+
+  uint32_t now = rtcManager.getEpoch(), from, to;
+  if (!parseAgo(argv[2], now, from) || !parseAgo(argv[3], now, to)) {
+    Log.println(usage);
+    return;
+  }
+  RollupAgg agg;
+  if (strcmp(argv[4], "min") == 0) agg = ROLLUP_MIN;
+  else if (strcmp(argv[4], "max") == 0) agg = ROLLUP_MAX;
+  else if (strcmp(argv[4], "avg") == 0) agg = ROLLUP_AVG;
+  else if (strcmp(argv[4], "count") == 0) agg = ROLLUP_COUNT;
+  else {
+    Log.println(usage);
+    return;
+  }
+
+  unsigned long t0 = micros();
+  Rollup::Result r = rollup.query(series, from, to);
+  unsigned long us = micros() - t0;
+
+  float v = r.value(agg);
+  if (agg != ROLLUP_COUNT) v *= 0.1f;
+  Log.printf("%.1f (%lu samples%s, %lu us)\n", v, (unsigned long)r.count,
+                r.approximate ? ", approximate edges" : "", us);
+}
+
+void cmdPower(int argc, char **argv) {
+  if (argc >= 3 && strcmp(argv[1], "budget") == 0) {
+    power.setBudgetMa((uint16_t)atoi(argv[2]));
+  } else if (argc >= 3 && strcmp(argv[1], "spacing") == 0) {
+    power.setSpacingMs((uint16_t)atoi(argv[2]));
+  } else if (argc >= 2 && strcmp(argv[1], "reset") == 0) {
+    power.resetLatency();
+  } else if (argc != 1) {
+    Log.println("Usage: power [budget <mA>|spacing <ms>|reset]");
+    return;
+  }
+  Log.printf("Power: %u/%u mA in use, %u queued\n",
+                (unsigned)power.getUsedMa(), (unsigned)power.getBudgetMa(),
+                (unsigned)power.getQueueLength());
+  Log.printf("Pump-off latency: last %lu us, worst %lu us\n",
+                (unsigned long)power.getLastOffLatencyUs(),
+                (unsigned long)power.getWorstOffLatencyUs());
+}
+
+void cmdTime(int argc, char **argv) {
+  if (argc != 7) {
+    Log.println("Usage: time <yy> <mm> <dd> <hh> <mm> <ss>");
+    return;
+  }
+  Ds1302::DateTime dt;
+  dt.year   = atoi(argv[1]);
+  dt.month  = atoi(argv[2]);
+  dt.day    = atoi(argv[3]);
+  dt.hour   = atoi(argv[4]);
+  dt.minute = atoi(argv[5]);
+  dt.second = atoi(argv[6]);
+  Ds1302::DateTime check;
+  RTCManager::fromEpoch(RTCManager::toEpoch(dt), check);
+  dt.dow = check.dow;
+  rtcManager.setDateTime(dt);
+  Log.printf("Time set to 20%02u-%02u-%02u %02u:%02u:%02u\n",
+             (unsigned)dt.year, (unsigned)dt.month, (unsigned)dt.day,
+             (unsigned)dt.hour, (unsigned)dt.minute, (unsigned)dt.second);
+}
+
+void cmdSample(int argc, char **argv) {
+  for (uint8_t z = 0; z < zones.count; z++) zones.nextCheck[z] = millis();
+  Log.println("Sampling all zones");
+}
+
+static void printHealth(const char *label, const SensorHealth &h, const char *action) {
+  uint8_t f = h.getSeen();
+  Log.printf("%s: %s%s, %lu bad readings%s\n", label,
+             h.isDegraded() ? "DEGRADED " : "", SensorHealth::name(f),
+             (unsigned long)h.getFaultReadings(), h.isDegraded() ? action : "");
+}
+
+void cmdFaults(int argc, char **argv) {
+  if (argc >= 2 && strcmp(argv[1], "reset") == 0) {
+    soil.resetHealth();
+    climate.resetHealth();
+    Log.println("Sensor faults cleared");
+  } else if (argc != 1) {
+    Log.println("Usage: faults [reset]");
+    return;
+  }
+  char label[12];
+  for (uint8_t z = 0; z < zones.count; z++) {
+    snprintf(label, sizeof(label), "Zone %u", (unsigned)(z + 1));
+    printHealth(label, soil.getHealth(z), " - watering suspended");
+  }
+  printHealth("Temperature", climate.getTemperatureHealth(), " - withheld");
+  printHealth("Humidity", climate.getHumidityHealth(), " - withheld");
+}
+
+void cmdStats(int argc, char **argv) {
+  if (argc >= 2 && strcmp(argv[1], "reset") == 0) {
+    climate.resetReadStats();
+  } else if (argc != 1) {
+    Log.println("Usage: stats [reset]");
+    return;
+  }
+  const DHTStats &s = climate.getReadStats();
+  Log.printf("DHT: %lu/%lu frames good, %lu retries, %lu reads failed%s\n",
+             (unsigned long)s.good, (unsigned long)s.attempts, (unsigned long)s.retries,
+             (unsigned long)s.failed, climate.readQualityPoor() ? " - POOR" : "");
+  Log.printf("  no reply %lu, timeout %lu, short %lu, checksum %lu\n",
+             (unsigned long)s.noReply, (unsigned long)s.timeouts,
+             (unsigned long)s.truncated, (unsigned long)s.checksum);
+  Log.printf("  weakest bit margin: <10%% %lu, <20%% %lu, <30%% %lu, <40%% %lu, <50%% %lu, more %lu (last %u%%)\n",
+             (unsigned long)s.margin[0], (unsigned long)s.margin[1], (unsigned long)s.margin[2],
+             (unsigned long)s.margin[3], (unsigned long)s.margin[4], (unsigned long)s.margin[5],
+             (unsigned)s.lastMargin);
+}
+
+void onRuleAction(RuleAction action, uint8_t zone, uint16_t arg) {
+  if (action == RULE_ACT_DOSE && zone < zones.count) {
+    Log.printf("Rule: dose zone %u\n", (unsigned)(zone + 1));
+    if (!water.doseNow(zone, arg)) Log.println("Zone busy, rule dose skipped");
+  }
+}
+
+void cmdRule(int argc, char **argv) {
+  const char *usage = "Usage: rule [list|add when <cond> then dose zoneN [ml]|del <n>]";
+  if (argc == 1 || strcmp(argv[1], "list") == 0) {
+    char text[RULE_TEXT_SIZE];
+    for (uint8_t i = 0; i < rules.size(); i++) {
+      if (!RuleEngine::loadText(i, text, sizeof(text))) strcpy(text, "?");
+      Log.printf("%2u%c %s\n", (unsigned)(i + 1), rules.get(i).active ? '*' : ' ', text);
+    }
+    Log.printf("%u rules, last pass ran %u in %lu us\n", (unsigned)rules.size(),
+               (unsigned)rules.getLastEvaluated(), (unsigned long)rules.getLastEvalUs());
+  } else if (strcmp(argv[1], "add") == 0 && argc >= 3) {
+    // The console split the text into words; join them back.
+    char text[RULE_TEXT_SIZE] = "";
+    for (int i = 2; i < argc; i++) {
+      if (i > 2) strncat(text, " ", sizeof(text) - strlen(text) - 1);
+      strncat(text, argv[i], sizeof(text) - strlen(text) - 1);
+    }
+    Rule r;
+    const char *error;
+    if (!RuleEngine::compile(text, r, error)) {
+      Log.printf("Rule error: %s\n", error);
+      return;
+    }
+    if (r.zone >= zones.count) {
+      Log.println("Rule error: no such zone");
+      return;
+    }
+    uint8_t slot = rules.size();
+    if (!rules.add(r)) {
+      Log.println("Rule table full");
+      return;
+    }
+    RuleEngine::saveText(slot, text);
+    Log.printf("Rule %u added (%u bytes of code)\n", (unsigned)(slot + 1), (unsigned)r.length);
+  } else if (strcmp(argv[1], "del") == 0 && argc >= 3) {
+    int n = atoi(argv[2]);
+    if (n < 1 || !rules.remove(n - 1)) {
+      Log.println("No such rule");
+      return;
+    }
+    char text[RULE_TEXT_SIZE];
+    for (uint8_t i = n - 1; i < rules.size(); i++) {
+      if (RuleEngine::loadText(i + 1, text, sizeof(text))) RuleEngine::saveText(i, text);
+    }
+    RuleEngine::eraseFrom(rules.size());
+    Log.printf("Rule %d deleted\n", n);
+  } else {
+    Log.println(usage);
+  }
+}
+
+void cmdHelp(int argc, char **argv);
+
+const ConsoleCommand consoleCommands[] = {
+  {"help", "help", cmdHelp},
+  {"zones", "zones", cmdZones},
+  {"dose",  "dose <zone> [now|set <ml> [pulse] [soak]|adaptive on|off [target]|calrun <s>|calml <ml>|save]", cmdDose},
+  {"predict", "predict", cmdPredict},
+  {"power", "power [budget <mA>|spacing <ms>|reset]", cmdPower},
+  {"time",  "time <yy> <mm> <dd> <hh> <mm> <ss>", cmdTime},
+  {"sample", "sample", cmdSample},
+  {"stats", "stats [reset]", cmdStats},
+  {"faults", "faults [reset]", cmdFaults},
+  {"rule",  "rule [list|add when <cond> then dose zoneN [ml]|del <n>]", cmdRule},
+  {"log",   "log [flush|dump <minutes>]", cmdLog},
+  {"history", "history <zone|t|h> <from> <to> min|max|avg|count", cmdHistory},
+  {"cal",  "cal <zone> show|add <pct>|set <mV> <pct>|clear|save|reset", cmdCalibrate},
+};
+SerialConsole console(consoleCommands, sizeof(consoleCommands) / sizeof(consoleCommands[0]), Log);
+
+void cmdHelp(int argc, char **argv) {
+  console.printHelp();
+}
 
 bool pumpState = false;
 
+// Napping: the UI task raises napRequested while it is idle and holds
+// uiBusy around its display and serial I/O; the control task takes the
+// nap itself, so the decision is made on live state, not a snapshot.
+std::atomic<bool> napRequested(false);
+std::atomic<bool> napWokeByUart(false);
+SemaphoreHandle_t uiBusy;
+
+void controlTask(void *arg);
+void nap();
+void uiTask(void *arg);
+void historyTask(void *arg);
+
 void setup() {
+  Pumps::begin();   // outputs off before anything else
+  ActuatorList<SoilPower>::begin();
   Serial.begin(115200);
 
   Wire.begin(22, 23);  // SDA=22, SCL=23
@@ -788,47 +1887,146 @@ void setup() {
   u8x8.setFont(u8x8_font_chroma48medium8_r);
   u8x8.clear();
 
-  sensor1.begin();
-  sensor2.begin();
-  Serial.println("SoilSensor ready");
+  zones.init(zoneConfig, zoneCount);
+  soil.begin();
+  sequences.start(soil);
+  Log.println("SoilSensor ready");
   delay(100);
 
   rtcManager.begin();
-  Serial.println("RTC ready");
+  Log.println("RTC ready");
   delay(100);
 
-  dhtDisplay.begin();
-  Serial.println("DTH ready");
+  climate.begin();
+  Log.println("DTH ready");
   delay(100);
 
+  for (uint8_t i = 0; i < ButtonPins::count; i++) buttons.add(ButtonPins::pins[i]);
+  buttons.begin();
+
   menu.begin();
-  Serial.println("OLED Menu ready");
+  Log.println("OLED Menu ready");
   delay(100);
 
-  wc1.begin();
-  wc2.begin();
-  Serial.println("WaterController ready");
+  water.begin();
+  history.begin();
+  publisher.update();
+  rules.setHandler(onRuleAction);
+  ruleRunner.begin();
+  Log.println("WaterController ready");
   
-  Serial.println("All Setup ready");
+  Log.println("All Setup ready");
   delay(1000);
+
+  uiBusy = xSemaphoreCreateMutex();
+  xTaskCreatePinnedToCore(controlTask, "control", 8192, nullptr, CONTROL_PRIORITY, nullptr, CONTROL_CORE);
+  xTaskCreatePinnedToCore(uiTask, "ui", 6144, nullptr, UI_PRIORITY, nullptr, UI_CORE);
+  if (historyLog.isReady()) {
+    xTaskCreatePinnedToCore(historyTask, "history", 3072, nullptr, HISTORY_PRIORITY, nullptr, HISTORY_CORE);
+  }
 }
 
+// Everything runs in the pinned tasks.
 void loop() {
-  bool b1 = btn1.update();
-  bool b2 = btn2.update();
-  bool b3 = btn3.update();
-  bool b4 = btn4.update();
+  vTaskDelete(nullptr);
+}
 
-  menu.update(b1, b2, b3, b4);
+// APP_CPU: sensors, watering and the power scheduler, plus console
+// commands (they touch controller state). Never waits on I2C or the UART.
+void controlTask(void *arg) {
+  for (;;) {
+    ConsoleLine line;
+    while (commandLines.pop(line)) console.execute(line.text);
+
+    sequences.update();
+    climate.update();
+    drying.setClimate(climate.getTemperature(), climate.getHumidity());
+    drying.update();
+    water.update();
+    power.update();
+    history.update();
+    publisher.update();
+    ruleRunner.update();
+    if (napRequested.load(std::memory_order_acquire)) nap();
+    vTaskDelay(1);
+  }
+}
 
-  sensor1.update(false);
-  sensor2.update(false);
+// PRO_CPU, lowest priority: erases and programs history pages handed over
+// by the control task, so it never waits on flash itself.
+void historyTask(void *arg) {
+  historyLog.runWriter();
+}
 
-  wc1.update();
-  wc2.update();
+// Light sleep stops both cores and every timer on them, so the control
+// task only naps between two passes of its loop while nothing it times is
+// running: no zone pumping, queued for power or between dose pulses, no
+// soil burst or DHT capture in flight. The nap ends before the next burst
+// or sample is due, and never cuts into the UI task's I/O.
+void nap() {
+  if (zones.dosing | zones.pumping | zones.waiting) return;
+  if (power.getUsedMa() || power.getQueueLength()) return;
+  uint32_t now = millis();
+  uint32_t ms = UI_NAP_MS;
+  uint32_t soilMs = soil.idleFor(now);
+  uint32_t climateMs = climate.idleFor(now);
+  if (soilMs < ms) ms = soilMs;
+  if (climateMs < ms) ms = climateMs;
+  if (ms < UI_NAP_MIN_MS) return;
+
+  if (xSemaphoreTake(uiBusy, 0) != pdTRUE) return;
+  if (napRequested.exchange(false)) {
+    Serial.flush();
+    buttons.lightSleep(ms);
+    if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_UART) napWokeByUart.store(true);
+  }
+  xSemaphoreGive(uiBusy);
 }
 
+// PRO_CPU: OLED, buttons and serial I/O. Talks to the control task only
+// through the state snapshot and the command/output rings.
+void uiTask(void *arg) {
+  // A keystroke wakes a nap too; that first character is lost, the console
+  // then stays awake for UI_IDLE_AFTER_MS.
+  uart_set_wakeup_threshold(UART_NUM_0, 3);
+  esp_sleep_enable_uart_wakeup(UART_NUM_0);
+  unsigned long lastInput = millis();
+
+  for (;;) {
+    xSemaphoreTake(uiBusy, portMAX_DELAY);
+    if (napWokeByUart.exchange(false)) lastInput = millis();
+    ConsoleLine line;
+    while (console.readLine(line.text)) {
+      lastInput = millis();
+      if (!commandLines.push(line)) Serial.println("Busy, command dropped");
+    }
 
+    // Presses step the menu; holding up/down keeps stepping. A double
+    // click on button 1 samples every zone right away.
+    ButtonEvent e;
+    bool handled = false;
+    while (buttons.poll(e)) {
+      lastInput = millis();
+      bool step = e.gesture == BUTTON_PRESS ||
+                  (e.gesture == BUTTON_REPEAT && (e.button == 1 || e.button == 2));
+      if (e.gesture == BUTTON_DOUBLE_CLICK && e.button == 0) {
+        ConsoleLine cmd = {"sample"};
+        commandLines.push(cmd);
+      }
+      if (!step) continue;
+      menu.update(e.button == 0, e.button == 1, e.button == 2, e.button == 3);
+      handled = true;
+    }
+    if (!handled) menu.update(false, false, false, false);
+
+    Log.drainTo(Serial);
+    bool idle = millis() - lastInput >= UI_IDLE_AFTER_MS && menu.isIdle() &&
+                !buttons.isScanning() && !Serial.available();
+    napRequested.store(idle, std::memory_order_release);
+    xSemaphoreGive(uiBusy);
+    vTaskDelay(pdMS_TO_TICKS(UI_PERIOD_MS));
+  }
+}
 
 void clearLine(uint8_t row) {
   char empty[LINE_WIDTH + 1];
@@ -836,15 +2034,3 @@ void clearLine(uint8_t row) {
   empty[LINE_WIDTH] = '\0';
   u8x8.drawString(0, row, empty);
 }
-
-
-
-
-
-
-
-
-
-
-
-
@@ -0,0 +1,278 @@
+// Host replay tests for DHTDecoder: pulse trains shaped like the ones the
+// bit-banged and RMT backends hand over, with jitter, glitches, truncation
+// and timeouts, plus a throughput benchmark. Run with
+//   pio test -e native -f test_dht_decoder
+
+#include <unity.h>
+
+#include <chrono>
+#include <stdio.h>
+
+#include "DHT_Decoder.h"
+#include "DHT_Decoder.cpp"
+
+// DHT22 frame for 65.2 %RH, 23.4 degC: 0x028C, 0x00EA, checksum 0x78.
+static const uint8_t FRAME[5] = {0x02, 0x8C, 0x00, 0xEA, 0x78};
+
+// Datasheet timings, microseconds.
+static const uint32_t START_LOW_US = 1100;   // our start pulse (RMT capture sees it)
+static const uint32_t RELEASE_US = 30;
+static const uint32_t RESPONSE_US = 80;
+static const uint32_t BIT_LOW_US = 50;
+static const uint32_t ZERO_HIGH_US = 27;
+static const uint32_t ONE_HIGH_US = 70;
+
+// Small deterministic generator, so a failing trace can be replayed.
+static uint32_t rngState;
+
+static uint32_t rng() {
+  rngState = rngState * 1664525u + 1013904223u;
+  return rngState >> 8;
+}
+
+// A value in [-range, range].
+static int32_t jitter(uint32_t range) {
+  return range ? (int32_t)(rng() % (2 * range + 1)) - (int32_t)range : 0;
+}
+
+struct Trace {
+  uint32_t pulses[128];
+  size_t count;
+};
+
+static void add(Trace &t, uint32_t d) {
+  if (t.count < sizeof(t.pulses) / sizeof(t.pulses[0]))
+    t.pulses[t.count++] = d;
+}
+
+// Builds the 80 bit pulses of data, optionally behind the preamble, scaled
+// by unitsPerUs (loop counts or timer ticks) with +-jitterUs on every pulse.
+static Trace makeTrace(const uint8_t data[5], bool preamble, uint32_t unitsPerUs,
+                       uint32_t jitterUs) {
+  Trace t;
+  t.count = 0;
+  if (preamble) {
+    add(t, START_LOW_US * unitsPerUs);
+    add(t, RELEASE_US * unitsPerUs);
+    add(t, RESPONSE_US * unitsPerUs);
+    add(t, RESPONSE_US * unitsPerUs);
+  }
+  for (int i = 0; i < DHT_FRAME_BITS; i++) {
+    bool one = data[i / 8] & (0x80 >> (i % 8));
+    int32_t low = BIT_LOW_US + jitter(jitterUs);
+    int32_t high = (one ? ONE_HIGH_US : ZERO_HIGH_US) + jitter(jitterUs);
+    add(t, (uint32_t)low * unitsPerUs);
+    add(t, (uint32_t)high * unitsPerUs);
+  }
+  return t;
+}
+
+// Splits pulse i into three by a glitchUs spike of the opposite level.
+static void insertGlitch(Trace &t, size_t i, uint32_t glitchUs, uint32_t unitsPerUs) {
+  uint32_t d = t.pulses[i];
+  uint32_t g = glitchUs * unitsPerUs;
+  for (size_t k = t.count - 1; k > i; k--)
+    t.pulses[k + 2] = t.pulses[k];
+  t.pulses[i] = d / 2;
+  t.pulses[i + 1] = g;
+  t.pulses[i + 2] = d - d / 2 - g;
+  t.count += 2;
+}
+
+void setUp(void) { rngState = 12345; }
+
+void tearDown(void) {}
+
+static void test_clean_frame(void) {
+  Trace t = makeTrace(FRAME, false, 1, 0);
+  DHTFrame f;
+  TEST_ASSERT_EQUAL(DHT_DECODE_OK, DHTDecoder::decode(t.pulses, t.count, 1, f));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(FRAME, f.data, 5);
+  TEST_ASSERT_EQUAL_UINT(DHT_FRAME_BITS, f.bits);
+  TEST_ASSERT_EQUAL_UINT(BIT_LOW_US, f.threshold);
+  TEST_ASSERT_TRUE(f.minMargin >= 40);
+}
+
+// The bit-banged path without a cycle counter hands over loop counts of no
+// fixed unit; the decoder only compares pulses with each other.
+static void test_loop_counts(void) {
+  Trace t = makeTrace(FRAME, false, 7, 5);
+  DHTFrame f;
+  TEST_ASSERT_EQUAL(DHT_DECODE_OK, DHTDecoder::decode(t.pulses, t.count, 0, f));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(FRAME, f.data, 5);
+}
+
+static void test_jitter(void) {
+  // +-10 us on every pulse, wider than the datasheet tolerances, still
+  // leaves the highs on their side of the ~50 us threshold. Every frame
+  // must decode, with weaker margins than a clean one.
+  int failures = 0;
+  uint8_t worst = 100;
+  for (int n = 0; n < 1000; n++) {
+    uint8_t data[5];
+    for (int b = 0; b < 4; b++)
+      data[b] = (uint8_t)rng();
+    data[4] = (uint8_t)(data[0] + data[1] + data[2] + data[3]);
+    Trace t = makeTrace(data, false, 1, 10);
+    DHTFrame f;
+    if (DHTDecoder::decode(t.pulses, t.count, 1, f) != DHT_DECODE_OK ||
+        f.data[0] != data[0] || f.data[1] != data[1] || f.data[2] != data[2] ||
+        f.data[3] != data[3])
+      failures++;
+    if (f.minMargin < worst)
+      worst = f.minMargin;
+  }
+  TEST_ASSERT_EQUAL_INT(0, failures);
+  TEST_ASSERT_TRUE(worst < 40);
+}
+
+static void test_glitches(void) {
+  // 1 us spikes inside a low and inside a high are stitched back.
+  Trace t = makeTrace(FRAME, false, 1, 0);
+  insertGlitch(t, 10, 1, 1);
+  insertGlitch(t, 41, 1, 1);
+  DHTFrame f;
+  TEST_ASSERT_EQUAL(DHT_DECODE_OK, DHTDecoder::decode(t.pulses, t.count, 1, f));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(FRAME, f.data, 5);
+
+  // Without a known unit there is no glitch rejection: the frame shifts by a
+  // bit and must not come out as OK.
+  TEST_ASSERT_TRUE(DHTDecoder::decode(t.pulses, t.count, 0, f) != DHT_DECODE_OK);
+}
+
+static void test_truncated(void) {
+  // 25 bits arrived: the first three bytes are whole, the fourth holds one
+  // bit, left-aligned.
+  Trace t = makeTrace(FRAME, false, 1, 0);
+  DHTFrame f;
+  TEST_ASSERT_EQUAL(DHT_DECODE_TRUNCATED, DHTDecoder::decode(t.pulses, 50, 1, f));
+  TEST_ASSERT_EQUAL_UINT(25, f.bits);
+  TEST_ASSERT_EQUAL_UINT8(FRAME[0], f.data[0]);
+  TEST_ASSERT_EQUAL_UINT8(FRAME[1], f.data[1]);
+  TEST_ASSERT_EQUAL_UINT8(FRAME[2], f.data[2]);
+  TEST_ASSERT_EQUAL_UINT8(FRAME[3] & 0x80, f.data[3]);
+  TEST_ASSERT_EQUAL_UINT(0, f.margin[25]);
+}
+
+static void test_timeout_and_no_reply(void) {
+  Trace t = makeTrace(FRAME, false, 1, 0);
+  t.pulses[31] = DHT_PULSE_TIMEOUT;
+  DHTFrame f;
+  TEST_ASSERT_EQUAL(DHT_DECODE_TIMEOUT, DHTDecoder::decode(t.pulses, t.count, 1, f));
+  TEST_ASSERT_EQUAL_UINT(15, f.bits);
+
+  TEST_ASSERT_EQUAL(DHT_DECODE_NO_REPLY, DHTDecoder::decode(t.pulses, 0, 1, f));
+  TEST_ASSERT_EQUAL_UINT(0, f.bits);
+}
+
+static void test_checksum(void) {
+  uint8_t data[5] = {FRAME[0], FRAME[1], FRAME[2], FRAME[3], (uint8_t)(FRAME[4] ^ 1)};
+  Trace t = makeTrace(data, false, 1, 0);
+  DHTFrame f;
+  TEST_ASSERT_EQUAL(DHT_DECODE_CHECKSUM, DHTDecoder::decode(t.pulses, t.count, 1, f));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(data, f.data, 5);
+}
+
+static void test_skip_preamble(void) {
+  // RMT captures start with our start pulse and the 80 us response.
+  const uint32_t ticks = 2;
+  Trace t = makeTrace(FRAME, true, ticks, 3);
+  size_t p = DHTDecoder::skipPreamble(t.pulses, t.count, ticks);
+  TEST_ASSERT_EQUAL_size_t(4, p);
+  DHTFrame f;
+  TEST_ASSERT_EQUAL(DHT_DECODE_OK, DHTDecoder::decode(t.pulses + p, t.count - p, ticks, f));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(FRAME, f.data, 5);
+
+  // Capture that begins at the response (start pulse already gone).
+  p = DHTDecoder::skipPreamble(t.pulses + 2, t.count - 2, ticks);
+  TEST_ASSERT_EQUAL_size_t(2, p);
+
+  // Only our own pulses, the sensor never answered.
+  TEST_ASSERT_EQUAL_size_t(2, DHTDecoder::skipPreamble(t.pulses, 2, ticks));
+  TEST_ASSERT_EQUAL_size_t(0, DHTDecoder::skipPreamble(t.pulses, 0, ticks));
+}
+
+static void test_from_rmt(void) {
+  // A capture as the RX channel records it: idle high, our start pulse and
+  // release, the response, then the bits, two halves per symbol
+  // (duration:15, level:1 each, from the LSB). The leading high puts the
+  // levels out of step with the symbols, and one high is split in two.
+  Trace t = makeTrace(FRAME, true, 1, 0);
+  uint16_t halves[200];
+  size_t h = 0;
+  halves[h++] = 0x8000 | 5;
+  for (size_t i = 0; i < t.count; i++) {
+    uint16_t level = i % 2 ? 0x8000 : 0;
+    if (i == 21) {
+      halves[h++] = level | 10;
+      halves[h++] = level | (uint16_t)(t.pulses[i] - 10);
+    } else {
+      halves[h++] = level | (uint16_t)t.pulses[i];
+    }
+  }
+  halves[h++] = 0; // end marker
+  if (h % 2) halves[h++] = 0;
+  uint32_t symbols[100];
+  for (size_t i = 0; i < h / 2; i++)
+    symbols[i] = halves[2 * i] | (uint32_t)halves[2 * i + 1] << 16;
+
+  uint32_t pulses[86];
+  size_t n = DHTDecoder::fromRmt(symbols, h / 2, pulses, 86);
+  TEST_ASSERT_EQUAL_size_t(t.count, n);
+  TEST_ASSERT_EQUAL_UINT32_ARRAY(t.pulses, pulses, n);
+
+  size_t p = DHTDecoder::skipPreamble(pulses, n, 1);
+  DHTFrame f;
+  TEST_ASSERT_EQUAL(DHT_DECODE_OK, DHTDecoder::decode(pulses + p, n - p, 1, f));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(FRAME, f.data, 5);
+
+  // Room for three pulses keeps the first three.
+  TEST_ASSERT_EQUAL_size_t(3, DHTDecoder::fromRmt(symbols, h / 2, pulses, 3));
+  TEST_ASSERT_EQUAL_UINT32(t.pulses[2], pulses[2]);
+}
+
+static void test_benchmark(void) {
+  // Decode throughput on the host, one frame = 80 pulses. Informational:
+  // the target is far slower, but the ratio between changes carries over.
+  const int FRAMES = 64;
+  const int ROUNDS = 2000;
+  static Trace traces[FRAMES];
+  for (int n = 0; n < FRAMES; n++) {
+    uint8_t data[5];
+    for (int b = 0; b < 4; b++)
+      data[b] = (uint8_t)rng();
+    data[4] = (uint8_t)(data[0] + data[1] + data[2] + data[3]);
+    traces[n] = makeTrace(data, false, 1, 10);
+  }
+
+  uint32_t ok = 0;
+  DHTFrame f;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < ROUNDS; r++) {
+    for (int n = 0; n < FRAMES; n++)
+      ok += DHTDecoder::decode(traces[n].pulses, traces[n].count, 1, f) == DHT_DECODE_OK;
+  }
+  auto end = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(end - start).count() /
+              ((double)FRAMES * ROUNDS);
+
+  char line[64];
+  snprintf(line, sizeof(line), "decode: %.0f ns/frame", ns);
+  TEST_MESSAGE(line);
+  TEST_ASSERT_EQUAL_UINT((uint32_t)FRAMES * ROUNDS, ok);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_clean_frame);
+  RUN_TEST(test_loop_counts);
+  RUN_TEST(test_jitter);
+  RUN_TEST(test_glitches);
+  RUN_TEST(test_truncated);
+  RUN_TEST(test_timeout_and_no_reply);
+  RUN_TEST(test_checksum);
+  RUN_TEST(test_skip_preamble);
+  RUN_TEST(test_from_rmt);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,152 @@
+// Host checks of Psychrometrics.h against the Magnus reference it is fitted
+// to, and a timing of the heat index against the pow() form it replaced.
+// Run with
+//   pio test -e native -f test_psychrometrics
+
+#include <unity.h>
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+
+#include "Psychrometrics.h"
+
+// Bounds the header promises over -20..60 degC and 1..100 %RH.
+static const double MAX_SVP_REL_ERROR = 1.5e-5;
+static const double MAX_DEW_POINT_ERROR = 2e-5;   // degC
+static const double MAX_HEAT_INDEX_ERROR = 0.005;  // degC
+
+// Magnus formula, Alduchov-Eskridge constants, in double.
+static double refSaturationVp(double t) {
+  return 0.61094 * exp(17.625 * t / (t + 243.04));
+}
+
+static double refDewPoint(double t, double rh) {
+  double g = log(rh / 100.0) + 17.625 * t / (243.04 + t);
+  return 243.04 * g / (17.625 - g);
+}
+
+// DHT::computeHeatIndex as it was before the float rewrite, with pow().
+static float powHeatIndex(float temperature, float percentHumidity) {
+  float hi;
+  temperature = temperature * 1.8 + 32;
+  hi = 0.5 * (temperature + 61.0 + ((temperature - 68.0) * 1.2) +
+              (percentHumidity * 0.094));
+  if (hi > 79) {
+    hi = -42.379 + 2.04901523 * temperature + 10.14333127 * percentHumidity +
+         -0.22475541 * temperature * percentHumidity +
+         -0.00683783 * pow(temperature, 2) +
+         -0.05481717 * pow(percentHumidity, 2) +
+         0.00122874 * pow(temperature, 2) * percentHumidity +
+         0.00085282 * temperature * pow(percentHumidity, 2) +
+         -0.00000199 * pow(temperature, 2) * pow(percentHumidity, 2);
+    if ((percentHumidity < 13) && (temperature >= 80.0) && (temperature <= 112.0))
+      hi -= ((13.0 - percentHumidity) * 0.25) *
+            sqrt((17.0 - fabs(temperature - 95.0)) * 0.05882);
+    else if ((percentHumidity > 85.0) && (temperature >= 80.0) && (temperature <= 87.0))
+      hi += ((percentHumidity - 85.0) * 0.1) * ((87.0 - temperature) * 0.2);
+  }
+  return (hi - 32) * 0.55555;
+}
+
+static void report(const char *what, double value) {
+  char line[80];
+  snprintf(line, sizeof(line), "%s: %.3g", what, value);
+  TEST_MESSAGE(line);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_saturation_vp(void) {
+  double worst = 0;
+  for (int i = -2000; i <= 6000; i++) {
+    float t = i * 0.01f;
+    double ref = refSaturationVp(t);
+    double err = fabs(Psychrometrics::saturationVp(t) - ref) / ref;
+    if (err > worst)
+      worst = err;
+  }
+  report("saturationVp max relative error", worst);
+  TEST_ASSERT_TRUE(worst < MAX_SVP_REL_ERROR);
+}
+
+static void test_dew_point(void) {
+  double worst = 0;
+  for (int i = -200; i <= 600; i++) {
+    float t = i * 0.1f;
+    for (int rh = 1; rh <= 100; rh++) {
+      double err = fabs(Psychrometrics::dewPoint(t, rh) - refDewPoint(t, rh));
+      if (err > worst)
+        worst = err;
+    }
+  }
+  report("dewPoint max error, degC", worst);
+  TEST_ASSERT_TRUE(worst < MAX_DEW_POINT_ERROR);
+  TEST_ASSERT_FLOAT_IS_NAN(Psychrometrics::dewPoint(20.0f, 0.0f));
+  TEST_ASSERT_FLOAT_IS_NAN(Psychrometrics::dewPoint(20.0f, NAN));
+}
+
+static void test_vpd(void) {
+  // At 100 %RH there is no deficit; at 0 % it is the whole saturation
+  // pressure.
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.0f, Psychrometrics::vpd(25.0f, 100.0f));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, Psychrometrics::saturationVp(25.0f),
+                           Psychrometrics::vpd(25.0f, 0.0f));
+  TEST_ASSERT_TRUE(Psychrometrics::vpd(25.0f, 60.0f, -2.0f) <
+                   Psychrometrics::vpd(25.0f, 60.0f));
+}
+
+static void test_heat_index(void) {
+  double worst = 0;
+  for (int i = -200; i <= 600; i++) {
+    float t = i * 0.1f;
+    for (int rh = 0; rh <= 100; rh++) {
+      double err = fabs(Psychrometrics::heatIndex(t, rh) - powHeatIndex(t, rh));
+      if (err > worst)
+        worst = err;
+    }
+  }
+  report("heatIndex max difference to pow() form, degC", worst);
+  TEST_ASSERT_TRUE(worst < MAX_HEAT_INDEX_ERROR);
+}
+
+// Times fn over the grid; the sum keeps the calls from being optimised out.
+template <typename Fn> static double timeGrid(Fn fn, volatile float &sink) {
+  const int ROUNDS = 50;
+  float sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < ROUNDS; r++) {
+    for (int i = -200; i <= 600; i += 2) {
+      for (int rh = 0; rh <= 100; rh += 2)
+        sum += fn(i * 0.1f + r * 1e-4f, (float)rh);
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  sink = sum;
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         (ROUNDS * 401.0 * 51.0);
+}
+
+static void test_heat_index_benchmark(void) {
+  // Informational: a host with a double FPU shows only part of the gain an
+  // ESP32 (single-precision FPU, soft double) would see.
+  volatile float sink;
+  double before = timeGrid(powHeatIndex, sink);
+  double after = timeGrid(Psychrometrics::heatIndex, sink);
+  report("heatIndex pow() form, ns/call", before);
+  report("heatIndex float Horner, ns/call", after);
+  report("speedup", before / after);
+  TEST_ASSERT_TRUE(after > 0);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_saturation_vp);
+  RUN_TEST(test_dew_point);
+  RUN_TEST(test_vpd);
+  RUN_TEST(test_heat_index);
+  RUN_TEST(test_heat_index_benchmark);
+  return UNITY_END();
+}